@@ -0,0 +1,166 @@
+#ifndef ANSI_COLOR_H
+#define ANSI_COLOR_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <vector>               // For the band buffers
+#include "ascii_lut.h"          // For intensity -> glyph tables and row kernels
+#include "thread_pool.h"        // For the tile-parallel band scheduler
+
+// * ANSI text modes
+#define ANSI_MODE_TRUECOLOR 1   // 24-bit escapes (38;2;R;G;B)
+#define ANSI_MODE_256       2   // xterm 256-color palette escapes (38;5;N)
+
+#define ANSI_ESCAPE_MAX     20  // Longest escape "\033[38;2;255;255;255m" plus its NUL
+#define ANSI_MAX_CELL_BYTES 20  // Longest escape plus the glyph
+#define ANSI_RESET          "\033[0m"
+#define ANSI_PALETTE_SIZE   32768  // One entry per RGB555 color
+
+// Two digit pairs "00".."99" for the integer formatter
+static const char ansiDigitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes value in decimal (no NUL), returns the number of digits
+// Reentrant and allocation-free, handles the 0 - 999 values of color escapes with at most two table loads
+static inline int formatUInt(char* dst, unsigned int value) {
+    if (value >= 100) {
+        unsigned int high = value / 100;
+        unsigned int low = value - high * 100;
+        int n = formatUInt(dst, high);
+        dst[n] = ansiDigitPairs[2 * low];
+        dst[n + 1] = ansiDigitPairs[2 * low + 1];
+        return n + 2;
+    }
+    if (value >= 10) {
+        dst[0] = ansiDigitPairs[2 * value];
+        dst[1] = ansiDigitPairs[2 * value + 1];
+        return 2;
+    }
+    dst[0] = (char)('0' + value);
+    return 1;
+}
+
+// Function to convert RGB values to an ANSI escape code for text foreground color
+// Writes the escape (e.g., \033[38;2;R;G;Bm) into dst (ANSI_ESCAPE_MAX bytes) and returns its length
+// Reentrant: no static buffer, safe to call from every band thread
+static inline int rgbToAnsiColor(cv::Vec3b pixel, char* dst) {
+    int n = 0;
+    memcpy(dst, "\033[38;2;", 7);
+    n += 7;
+    n += formatUInt(dst + n, pixel[2]);
+    dst[n++] = ';';
+    n += formatUInt(dst + n, pixel[1]);
+    dst[n++] = ';';
+    n += formatUInt(dst + n, pixel[0]);
+    dst[n++] = 'm';
+    dst[n] = '\0';
+    return n;
+}
+
+// Same as rgbToAnsiColor() for the background color (\033[48;2;R;G;Bm)
+static inline int rgbToAnsiBackground(cv::Vec3b pixel, char* dst) {
+    int n = rgbToAnsiColor(pixel, dst);
+    dst[2] = '4';
+    return n;
+}
+
+// Writes the 256-color escape (\033[38;5;Nm) for a palette index into dst, returns its length
+static inline int paletteToAnsiColor(unsigned char index, char* dst) {
+    int n = 0;
+    memcpy(dst, "\033[38;5;", 7);
+    n += 7;
+    n += formatUInt(dst + n, index);
+    dst[n++] = 'm';
+    dst[n] = '\0';
+    return n;
+}
+
+// RGB555 key of a BGR pixel (index of the palette table)
+static inline int rgb555Key(cv::Vec3b pixel) {
+    return ((pixel[2] >> 3) << 10) | ((pixel[1] >> 3) << 5) | (pixel[0] >> 3);
+}
+
+// Builds the RGB555 -> xterm 256-color table (indexes 16 - 255: 6x6x6 cube and 24 grays)
+// The nearest cube color is found per channel (distance is separable), then compared with the nearest gray
+static inline void buildAnsi256Table(unsigned char table[ANSI_PALETTE_SIZE]) {
+    static const int cubeLevels[6] = {0, 95, 135, 175, 215, 255};
+    int nearestLevel[32];
+    for (int c5 = 0; c5 < 32; c5++) {
+        int value = (c5 << 3) | (c5 >> 2);  // Center of the 5-bit bucket
+        int best = 0;
+        for (int l = 1; l < 6; l++) {
+            if (abs(cubeLevels[l] - value) < abs(cubeLevels[best] - value)) best = l;
+        }
+        nearestLevel[c5] = best;
+    }
+
+    for (int key = 0; key < ANSI_PALETTE_SIZE; key++) {
+        int r5 = (key >> 10) & 31, g5 = (key >> 5) & 31, b5 = key & 31;
+        int r = (r5 << 3) | (r5 >> 2), g = (g5 << 3) | (g5 >> 2), b = (b5 << 3) | (b5 >> 2);
+
+        int lr = nearestLevel[r5], lg = nearestLevel[g5], lb = nearestLevel[b5];
+        int dr = r - cubeLevels[lr], dg = g - cubeLevels[lg], db = b - cubeLevels[lb];
+        int cubeDistance = dr * dr + dg * dg + db * db;
+
+        // Gray ramp is 8, 18, ..., 238: nearest step to the channel mean
+        int gray = ((r + g + b) / 3 - 8 + 5) / 10;
+        gray = gray < 0 ? 0 : (gray > 23 ? 23 : gray);
+        int level = 8 + 10 * gray;
+        int grayDistance = (r - level) * (r - level) + (g - level) * (g - level) + (b - level) * (b - level);
+
+        table[key] = (unsigned char)(grayDistance < cubeDistance ? 232 + gray : 16 + 36 * lr + 6 * lg + lb);
+    }
+}
+
+// Converts one row to colored text: an escape only when the color changes from the previous cell
+// Every row ends with a reset and a breakline so it can be read on its own
+// dst needs cols * ANSI_MAX_CELL_BYTES + 5 bytes, returns the bytes written
+static inline size_t ansiRowToText(const uchar* gray, const cv::Vec3b* pixels, int cols, const unsigned char* glyphLUT,
+                                   const unsigned char* paletteTable, int mode, char* dst) {
+    size_t n = 0;
+    int previous = -1;
+    for (int j = 0; j < cols; j++) {
+        int key = (mode == ANSI_MODE_256) ? paletteTable[rgb555Key(pixels[j])]
+                                          : (pixels[j][2] << 16) | (pixels[j][1] << 8) | pixels[j][0];
+        if (key != previous) {
+            n += (mode == ANSI_MODE_256) ? paletteToAnsiColor((unsigned char)key, dst + n) : rgbToAnsiColor(pixels[j], dst + n);
+            previous = key;
+        }
+        dst[n++] = (char)glyphLUT[gray[j]];
+    }
+    memcpy(dst + n, ANSI_RESET "\n", 5);
+    return n + 5;
+}
+
+// Converts the resized image to colored text, one buffer per band (stitched in order by the caller)
+// Glyphs come from the same grayscale intensities as the plain text mode
+static inline void convertAnsiFrame(const cv::Mat& image, const unsigned char* glyphLUT, const unsigned char* paletteTable,
+                                    int mode, int threads, std::vector<std::vector<char>>& bandText,
+                                    std::vector<WorkerLoad>* loads = NULL) {
+    int rows = image.rows;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    bandText.assign(bands, std::vector<char>());
+
+    parallelForBands(bands, threads, [&](int band) {
+        int first = band * bandRows;
+        int last = first + bandRows < rows ? first + bandRows : rows;
+
+        cv::Mat grayImage;
+        cv::cvtColor(image.rowRange(first, last), grayImage, cv::COLOR_BGR2GRAY);
+
+        std::vector<char>& text = bandText[band];
+        text.resize((size_t)(last - first) * ((size_t)image.cols * ANSI_MAX_CELL_BYTES + 5));
+        size_t used = 0;
+        for (int i = first; i < last; i++) {
+            used += ansiRowToText(grayImage.ptr<uchar>(i - first), image.ptr<cv::Vec3b>(i), image.cols, glyphLUT,
+                                  paletteTable, mode, text.data() + used);
+        }
+        text.resize(used);
+    }, loads);
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+#include <dirent.h>             // For directory listing
+#include <glob.h>               // For glob patterns
+#include <sys/stat.h>           // For file types
+#include <algorithm>            // For sorting the inputs
+#include <string>               // For input/output paths
+#include <thread>               // For the decode and write stages
+#include <vector>               // For the input list
+#include "image2ascii.h"        // For the library API
+#include "ascii_convert.h"      // For imageViewOfMat() and writeView()
+#include "ascii_decode.h"       // For decode-time reduction
+#include "ascii_output.h"       // For writeFileAll()
+#include "ascii_stats.h"        // For stage timers
+#include "pipeline.h"           // For the bounded queues between stages
+#include "result_cache.h"       // For skipping inputs already converted
+
+#define BATCH_QUEUE_CAPACITY 4  // Images in flight between two stages (bounds memory)
+
+namespace ascii {
+
+Status collectBatchInputs(const char* spec, std::vector<std::string>& inputs) {
+    struct stat info;
+    if (stat(spec, &info) == 0 && S_ISDIR(info.st_mode)) {
+        DIR* dir = opendir(spec);
+        if (dir == NULL) return ERROR_LOAD;
+        for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;  // Hidden files, "." and ".."
+            std::string path = std::string(spec) + "/" + entry->d_name;
+            if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && cv::haveImageReader(path)) {
+                inputs.push_back(path);
+            }
+        }
+        closedir(dir);
+        std::sort(inputs.begin(), inputs.end());  // Stable order between runs
+        return OK;
+    }
+
+    if (strpbrk(spec, "*?[") != NULL) {
+        glob_t matches;
+        if (glob(spec, 0, NULL, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; i++) {
+                inputs.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+        return OK;
+    }
+
+    FILE* list = fopen(spec, "r");
+    if (list == NULL) return ERROR_LOAD;
+    char line[4096];
+    while (fgets(line, sizeof(line), list) != NULL) {
+        line[strcspn(line, "\r\n")] = 0;  // Remove the newline at the end
+        if (line[0] != '\0') inputs.push_back(line);
+    }
+    fclose(list);
+    return OK;
+}
+
+// Output path of an input: outputDir/<file name>.txt (or .png for colored images)
+static std::string batchOutputPath(const std::string& input, const Options& options, const char* outputDir) {
+    size_t slash = input.find_last_of("/\\");
+    std::string name = (slash == std::string::npos) ? input : input.substr(slash + 1);
+    return std::string(outputDir) + "/" + name + (options.mode == MODE_COLOR_IMAGE ? ".png" : ".txt");
+}
+
+// Image between the decode and convert stages
+struct BatchDecoded {
+    size_t index;
+    Status status;
+    cv::Mat image;
+    int sourceWidth;   // Full size of an image decoded reduced
+    int sourceHeight;
+    bool cached;       // Output already copied from the result cache, nothing left to do
+    std::string key;   // Result cache key, empty without a cache
+};
+
+// Result between the convert and write stages
+struct BatchConverted {
+    size_t index;
+    Status status;
+    std::vector<char> text;  // Text or ANSI text
+    bool written;            // Colored image already written by the convert stage
+    bool cached;
+    std::string key;
+};
+
+// Batch within Options::maxMemory: every input is streamed in strips (convertFile() -> streamFile()) one after the
+// other, since the pipeline below holds whole decoded images in flight
+static int runStreamedBatch(const std::vector<std::string>& inputs, const Options& options, const char* outputDir,
+                            BatchReport report) {
+    Options streamed = options;
+    streamed.echo = false;  // Batch text only goes to the files
+    int failures = 0;
+    for (size_t index = 0; index < inputs.size(); index++) {
+        std::string outputPath = batchOutputPath(inputs[index], options, outputDir);
+        Status status = convertFile(inputs[index].c_str(), outputPath.c_str(), streamed);
+        if (status != OK) failures++;
+        report(inputs[index].c_str(), outputPath.c_str(), status);
+    }
+    return failures;
+}
+
+// Three stages joined by bounded queues:
+// decode (cv::imread, reduced when possible) -> convert (Converter, parallel bands) -> write (file)
+// Decode of image N+1 and the write of image N-1 overlap the conversion of image N
+// Colored images are rendered and PNG-encoded strip by strip in the convert stage (writeView()), so no canvas is
+// ever held whole or queued; the write stage only stores and reports them
+int runBatch(const std::vector<std::string>& inputs, const Options& options, const char* outputDir, BatchReport report) {
+    if (options.maxMemory > 0) {
+        return runStreamedBatch(inputs, options, outputDir, report);
+    }
+    BoundedQueue<BatchDecoded> decoded(BATCH_QUEUE_CAPACITY);
+    BoundedQueue<BatchConverted> converted(BATCH_QUEUE_CAPACITY);
+    Converter converter(options);  // Charset tables are built once for the whole batch
+    Stats* stats = options.stats;  // Each stage thread only updates its own counters
+
+    // Stage 1: decode
+    std::thread decoder([&] {
+        for (size_t index = 0; index < inputs.size(); index++) {
+            BatchDecoded item;
+            item.index = index;
+            item.cached = false;
+            std::string outputPath = batchOutputPath(inputs[index], options, outputDir);
+            if (!options.cacheDir.empty() && cacheKey(inputs[index].c_str(), outputPath.c_str(), options, item.key) == 0) {
+                item.cached = cacheFetch(options.cacheDir.c_str(), item.key, outputPath.c_str(), false) == 0;  // Hit: no decode
+                if (stats != NULL) (item.cached ? stats->cacheHits : stats->cacheMisses)++;
+            }
+            if (item.cached) {
+                item.status = OK;
+                decoded.push(std::move(item));
+                continue;
+            }
+            double start = stageStart(stats);
+            item.image = decodeForCells(inputs[index].c_str(), options, &item.sourceWidth, &item.sourceHeight);
+            item.status = item.image.empty() ? ERROR_LOAD : OK;
+            stageEnd(stats, STAGE_DECODE, start);
+            decoded.push(std::move(item));
+        }
+        decoded.close();
+    });
+
+    // Stage 3: write (reports every input, in order)
+    int failures = 0;
+    std::thread writer([&] {
+        BatchConverted item;
+        while (converted.pop(item)) {
+            std::string outputPath = batchOutputPath(inputs[item.index], options, outputDir);
+            if (item.status == OK && !item.cached) {
+                if (!item.written) {
+                    double start = stageStart(stats);
+                    if (writeFileAll(outputPath.c_str(), item.text.data(), item.text.size()) != 0) {
+                        item.status = ERROR_OUTPUT;
+                    }
+                    stageEnd(stats, STAGE_WRITE, start);
+                    if (stats != NULL && item.status == OK) {
+                        stats->bytesWritten += (long long)item.text.size();
+                    }
+                }
+                if (item.status == OK && !item.key.empty()) {
+                    cacheStore(options.cacheDir.c_str(), item.key, outputPath.c_str(), options.cacheLimit);
+                }
+            }
+            if (item.status != OK) failures++;
+            report(inputs[item.index].c_str(), outputPath.c_str(), item.status);
+            std::vector<char>().swap(item.text);
+        }
+    });
+
+    // Stage 2: convert (on the calling thread, bands spread over options.threads)
+    BatchDecoded item;
+    while (decoded.pop(item)) {
+        BatchConverted result;
+        result.index = item.index;
+        result.status = item.status;
+        result.written = false;
+        result.cached = item.cached;
+        result.key = item.key;
+        if (result.status == OK && !result.cached) {
+            ImageView view = imageViewOfMat(item.image, item.sourceWidth, item.sourceHeight);
+            if (options.mode == MODE_COLOR_IMAGE) {
+                // Rendering overlaps the PNG encoder thread, only its strip ring is held
+                std::string outputPath = batchOutputPath(inputs[item.index], options, outputDir);
+                result.status = writeView(converter, view, outputPath.c_str());
+                result.written = true;
+            } else {
+                int cols, rows;
+                result.status = converter.gridSize(view, &cols, &rows);
+                if (result.status == OK) {
+                    result.text.resize(converter.maxTextSize(view));
+                    Span span = {result.text.data(), result.text.size()};
+                    size_t written = 0;
+                    result.status = converter.convertText(view, span, &written);
+                    result.text.resize(written);
+                }
+            }
+        }
+        item.image.release();  // Decoded pixels are not needed anymore
+        converted.push(std::move(result));
+    }
+    converted.close();
+
+    decoder.join();
+    writer.join();
+    return failures;
+}
+
+}  // namespace ascii
@@ -0,0 +1,594 @@
+#include <errno.h>              // For the strtol() range errors
+#include <limits.h>             // For INT_MAX
+#include <stdint.h>             // For SIZE_MAX
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <strings.h>            // For strcasecmp()
+#include <unistd.h>             // For isatty()
+#include "ascii_cli.h"          // For the message table
+
+// * Default values (scales and charset come from image2ascii.h)
+#define DEFAULT_OUTPUT_PATH "output.txt"  // Default output file name and path
+#define DEFAULT_COLOR_OUTPUT_PATH "output.png"  // Default output file name and path in color
+#define OUTPUT_PATH_MAX 4096              // Longest output path, with its NUL
+
+// * --stats report formats
+#define STATS_OFF  0
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+// Messages of the running language (the batch report callback has no user data)
+static const CliStrings* cliStrings = NULL;
+
+// Display help if --help flag
+static void helpFlag(const char* programName) {
+    printf(cliStrings->help, programName, DEFAULT_WIDTH_SCALE, DEFAULT_HEIGHT_SCALE, DEFAULT_ASCII_CHARS);
+}
+
+// Prints the result of each batch input (failures on stderr)
+static void batchReport(const char* inputPath, const char* outputPath, ascii::Status status) {
+    switch (status) {
+        case ascii::OK:           printf(cliStrings->batchConverted, inputPath, outputPath); break;
+        case ascii::ERROR_LOAD:   fprintf(stderr, cliStrings->batchLoadError, inputPath); break;
+        case ascii::ERROR_SIZE:   fprintf(stderr, cliStrings->batchSizeError, inputPath); break;
+        case ascii::ERROR_OUTPUT: fprintf(stderr, cliStrings->batchOutputError, outputPath); break;
+        case ascii::ERROR_MEMORY: fprintf(stderr, cliStrings->batchMemoryError, inputPath); break;
+        default:                  fprintf(stderr, cliStrings->batchConvertError, inputPath); break;
+    }
+}
+
+// Prints a command line error (format takes the option, then its value) and the usage on stderr
+// Returns the exit status of a bad command line
+static int usageError(const char* programName, const char* format, const char* option, const char* value) {
+    if (format != NULL) {
+        fprintf(stderr, format, option, value);
+    }
+    fprintf(stderr, cliStrings->usage, programName);
+    return -1;
+}
+
+// Options followed by a value, told apart from unknown ones when the value is missing
+static bool takesValue(const char* option) {
+    static const char* const options[] = {
+        "--threads", "--batch", "--out-dir", "--dither", "--video", "--max-memory", "--serve", "--workers", "--queue",
+        "--max-request", "--pyramid", "--cells", "--cache", "--cache-limit", "--output", "--width-scale", "--height-scale",
+        "--chars"
+    };
+    for (size_t k = 0; k < sizeof(options) / sizeof(options[0]); k++) {
+        if (strcmp(option, options[k]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses a whole decimal count of at least minimum
+// Returns 0 on success and -1 for trailing characters, an empty or an out of range value
+static int parseCount(const char* text, int minimum, int* value) {
+    char* end;
+    errno = 0;
+    long count = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || count < minimum || count > INT_MAX) {
+        return -1;
+    }
+    *value = (int)count;
+    return 0;
+}
+
+// Parses a --max-memory size: bytes with an optional K, M or G suffix (powers of 1024)
+// Returns 0 for an invalid size, a negative one or one that does not fit in size_t
+static size_t parseByteSize(const char* text) {
+    char* end;
+    errno = 0;
+    unsigned long long size = strtoull(text, &end, 10);
+    if (end == text || errno != 0 || strchr(text, '-') != NULL || size > SIZE_MAX) {
+        return 0;  // strtoull() would wrap a minus sign around
+    }
+    int shift = 0;
+    switch (*end) {
+        case 'K': case 'k': shift = 10; end++; break;
+        case 'M': case 'm': shift = 20; end++; break;
+        case 'G': case 'g': shift = 30; end++; break;
+        default: break;
+    }
+    if (*end != '\0' || size > (unsigned long long)(SIZE_MAX >> shift)) {
+        return 0;
+    }
+    return (size_t)size << shift;
+}
+
+// Parses --pyramid levels: comma-separated column counts ("80") or scales ("10x20"), each written next to
+// outputPath with the level inserted before the extension (output.txt -> output-80.txt)
+// Returns 0 on success and -1 on a malformed list
+static int parsePyramid(const char* spec, const char* outputPath, std::vector<ascii::PyramidLevel>& levels) {
+    std::string path = outputPath;
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = path.size();
+
+    const char* p = spec;
+    while (*p != '\0') {
+        const char* end = strchr(p, ',');
+        std::string token(p, end != NULL ? (size_t)(end - p) : strlen(p));
+        ascii::PyramidLevel level;
+        int a, b;
+        char extra;
+        if (sscanf(token.c_str(), "%dx%d%c", &a, &b, &extra) == 2 && a > 0 && b > 0) {
+            level.widthScale = a;
+            level.heightScale = b;
+        } else if (sscanf(token.c_str(), "%d%c", &a, &extra) == 1 && a > 0) {
+            level.columns = a;
+        } else {
+            return -1;
+        }
+        level.outputPath = path.substr(0, dot) + "-" + token + path.substr(dot);
+        levels.push_back(level);
+        p = end != NULL ? end + 1 : p + token.size();
+    }
+    return levels.empty() ? -1 : 0;
+}
+
+// Reads one answer line into buffer (at most size - 1 bytes, the rest of a longer line is dropped, never overflowed)
+// Returns 0 for an answer and -1 for an empty line or the end of input (the default applies)
+static int readAnswer(char* buffer, size_t size) {
+    fflush(stderr);
+    if (fgets(buffer, (int)size, stdin) == NULL) {
+        buffer[0] = '\0';
+        return -1;
+    }
+    size_t length = strcspn(buffer, "\n");
+    if (buffer[length] != '\n') {
+        int c;
+        while ((c = getchar()) != '\n' && c != EOF) {}  // Longer than the buffer: skip to the next line
+    }
+    buffer[length] = '\0';  // Remove the newline at the end
+    return length > 0 ? 0 : -1;
+}
+
+// Output path of an answer or --output, used as given (no extension is added, "-" is stdout)
+// An empty answer takes the default name and a directory (trailing slash) gets the default name inside it
+// Returns 0 on success and -1 if the path does not fit
+static int resolveOutputPath(const char* answer, int colorChoice, char* outputPath, size_t size) {
+    const char* defaultName = colorChoice == 1 ? DEFAULT_COLOR_OUTPUT_PATH : DEFAULT_OUTPUT_PATH;
+    size_t length = strlen(answer);
+    int written;
+    if (length == 0) {
+        written = snprintf(outputPath, size, "%s", defaultName);
+    } else if (answer[length - 1] == '/' || answer[length - 1] == '\\') {
+        written = snprintf(outputPath, size, "%s%s", answer, defaultName);
+    } else {
+        written = snprintf(outputPath, size, "%s", answer);
+    }
+    return written >= 0 && (size_t)written < size ? 0 : -1;
+}
+
+// Reads the whole encoded image piped to stdin, returns 0 on success and -1 on error or no data
+static int readStdin(std::vector<unsigned char>& bytes) {
+    unsigned char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + got);
+    }
+    return ferror(stdin) || bytes.empty() ? -1 : 0;
+}
+
+// Library settings from the command line values (colored image wins over the other text modes)
+static ascii::Options makeOptions(int widthScale, int heightScale, const char* asciiChars, int colorChoice, int textMode,
+                                  bool shapeMatch, int dither, int threads, bool echo, bool mmapOutput, ascii::Stats* stats) {
+    ascii::Options options;
+    options.widthScale = widthScale;
+    options.heightScale = heightScale;
+    options.asciiChars = asciiChars;
+    options.mode = colorChoice == 1 ? ascii::MODE_COLOR_IMAGE : (ascii::Mode)(textMode != 0 ? textMode : ascii::MODE_TEXT);
+    options.match = shapeMatch ? ascii::MATCH_SHAPE : ascii::MATCH_BRIGHTNESS;
+    options.dither = (ascii::Dither)dither;
+    options.threads = threads;
+    options.echo = echo;
+    options.mmapOutput = mmapOutput;
+    options.stats = stats;
+    return options;
+}
+
+// Result cache settings of --cache (no cache without a directory)
+static void setCacheOptions(ascii::Options& options, const char* cacheDir, unsigned long long cacheLimit) {
+    if (cacheDir != NULL) {
+        options.cacheDir = cacheDir;
+        options.cacheLimit = cacheLimit;
+    }
+}
+
+// Prints the --stats report on stderr, so the text on stdout stays clean
+static void printStats(ascii::Stats& stats, int statsMode) {
+    if (statsMode == STATS_OFF) {
+        return;
+    }
+    ascii::finishStats(stats);
+    if (statsMode == STATS_JSON) {
+        fprintf(stderr, "%s\n", ascii::statsToJSON(stats).c_str());
+        return;
+    }
+
+    const CliStrings& s = *cliStrings;
+    fprintf(stderr, "%s\n", s.statsTitle);
+    for (int k = 0; k < ascii::STAGE_COUNT; k++) {
+        fprintf(stderr, "  %-14s %10.3f ms\n", s.stageNames[k], stats.stageSeconds[k] * 1000.0);
+    }
+    fprintf(stderr, "  %-14s %10.3f ms\n", s.statsWall, stats.wallSeconds * 1000.0);
+    fprintf(stderr, "  %-14s %lld (%.0f %s)\n", s.statsCells, stats.cells,
+            stats.wallSeconds > 0.0 ? (double)stats.cells / stats.wallSeconds : 0.0, s.statsCellsRate);
+    fprintf(stderr, "  %-14s %lld bytes\n", s.statsWritten, stats.bytesWritten);
+    fprintf(stderr, "  %-14s ", "cache");
+    fprintf(stderr, s.statsCache, stats.cacheHits, stats.cacheMisses);
+    fprintf(stderr, "\n  %-14s %ld KB\n", s.statsPeak, stats.peakRSSKB);
+    for (size_t t = 0; t < stats.threads.size() && stats.threads.size() > 1; t++) {
+        fprintf(stderr, s.statsThread, (int)t, stats.threads[t].bands, stats.threads[t].busySeconds * 1000.0);
+    }
+}
+
+// Prints the --cache counters on out, so a run shows how much it reused
+static void printCacheReport(const ascii::Stats& stats, const char* cacheDir, FILE* out) {
+    if (cacheDir != NULL) {
+        fprintf(out, cliStrings->cacheReport, stats.cacheHits, stats.cacheMisses);
+    }
+}
+
+// Command line of image_to_ascii and image_to_ascii_br, only the messages differ
+int runCli(int argc, char** argv, const CliStrings& strings) {
+    cliStrings = &strings;
+
+    // Display help manual if --help is passed
+    if (argc == 2 && strcmp(argv[1], "--help") == 0) {
+        helpFlag(argv[0]); // Display help manual in terminal
+        return 0; // Exit after displaying help
+    }
+
+    // Check the LUT kernels against intensityToASCII if --self-test is passed
+    if (argc == 2 && strcmp(argv[1], "--self-test") == 0) {
+        int failures = ascii::selfTest();
+        if (failures != 0) {
+            fprintf(stderr, strings.selfTestFailed, failures);
+            return -1;
+        }
+        printf("%s\n", strings.selfTestPassed);
+        return 0;
+    }
+
+    int widthScale = DEFAULT_WIDTH_SCALE;     // Default
+    int heightScale = DEFAULT_HEIGHT_SCALE;   // Default
+    int colorChoice = 0;                      // Default
+    char asciiChars[257];                     // Array to store user-defined ASCII characters (256 MAX, one byte per glyph)
+    char userPath[OUTPUT_PATH_MAX];           // Answer of the output path prompt
+    char outputPath[OUTPUT_PATH_MAX];         // Output path ("-" for stdout)
+    strcpy(asciiChars, DEFAULT_ASCII_CHARS);  // Initialize with default value
+    strcpy(outputPath, DEFAULT_OUTPUT_PATH);  // Initialize with default value
+
+    // If no path || invalid
+    if (argc < 2) {
+        return usageError(argv[0], NULL, NULL, NULL);
+    }
+
+    // Check the option flags
+    bool useDefaults = false;
+    bool echo = true;                        // Text frame goes to the file and the terminal
+    bool mmapOutput = false;                 // Text file written through an mmap'd region
+    int threads = 0;                         // Every core unless --threads is given
+    const char* batchSpec = NULL;            // Directory, glob or file list of --batch
+    const char* outputDir = ".";             // Output directory of --batch
+    const char* videoSource = NULL;          // Video file, device or camera index of --video
+    int textMode = 0;                        // ascii::MODE_* of ANSI, half-block or Braille text, 0 for plain text
+    bool shapeMatch = false;                 // Plain text glyphs matched by shape (--shape)
+    int dither = ascii::DITHER_NONE;         // ascii::DITHER_* of --dither
+    int statsMode = STATS_OFF;               // --stats report format
+    size_t maxMemory = 0;                    // Strip streaming budget of --max-memory, 0 loads the whole image
+    bool viewMode = false;                   // Interactive viewer of --view
+    const char* serveAddress = NULL;         // Socket path or [host:]port of --serve
+    int workers = 0;                         // Requests converted at once by --serve, 0 for every core
+    int queueDepth = 0;                      // Requests waiting for a --serve worker, 0 for as many as workers
+    size_t maxRequest = 0;                   // Image bytes a --serve request may send, 0 for the protocol default
+    const char* cacheDir = NULL;             // Result cache directory of --cache
+    const char* cellsPath = NULL;            // Cell file of --cells, written instead of the text or image
+    const char* pyramidSpec = NULL;          // Levels of --pyramid
+    unsigned long long cacheLimit = DEFAULT_CACHE_LIMIT;  // Size limit of --cache
+    const char* outputArg = NULL;            // Output path of --output ("-" for stdout)
+    const char* charsArg = NULL;             // Charset of --chars
+    const char* imagePath = NULL;            // Input image ("-" for stdin), none in the batch, video and server modes
+    bool colorGiven = false;                 // Values given as flags are never asked
+    bool widthGiven = false;
+    bool heightGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--default") == 0) {
+            useDefaults = true;
+        } else if (strcmp(argv[i], "--no-echo") == 0) {
+            echo = false;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            mmapOutput = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (parseCount(argv[++i], 0, &threads) != 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--color") == 0) {
+            colorChoice = 1;
+            colorGiven = true;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchSpec = argv[++i];
+        } else if (strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (strcmp(argv[i], "--ansi") == 0) {
+            textMode = ascii::MODE_ANSI_TRUECOLOR;
+        } else if (strcmp(argv[i], "--ansi256") == 0) {
+            textMode = ascii::MODE_ANSI_256;
+        } else if (strcmp(argv[i], "--half-block") == 0) {
+            textMode = ascii::MODE_HALF_BLOCK;
+        } else if (strcmp(argv[i], "--braille") == 0) {
+            textMode = ascii::MODE_BRAILLE;
+        } else if (strcmp(argv[i], "--shape") == 0) {
+            shapeMatch = true;
+        } else if (strcmp(argv[i], "--dither") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "ordered") == 0) {
+                dither = ascii::DITHER_ORDERED;
+            } else if (strcmp(argv[i], "floyd") == 0) {
+                dither = ascii::DITHER_FLOYD_STEINBERG;
+            } else {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--video") == 0 && i + 1 < argc) {
+            videoSource = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            statsMode = STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            statsMode = STATS_JSON;
+        } else if (strcmp(argv[i], "--max-memory") == 0 && i + 1 < argc) {
+            maxMemory = parseByteSize(argv[++i]);
+            if (maxMemory == 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--view") == 0) {
+            viewMode = true;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serveAddress = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            if (parseCount(argv[++i], 0, &workers) != 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            if (parseCount(argv[++i], 0, &queueDepth) != 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--pyramid") == 0 && i + 1 < argc) {
+            pyramidSpec = argv[++i];
+        } else if (strcmp(argv[i], "--cells") == 0 && i + 1 < argc) {
+            cellsPath = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--max-request") == 0 && i + 1 < argc) {
+            maxRequest = parseByteSize(argv[++i]);
+            if (maxRequest == 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--cache-limit") == 0 && i + 1 < argc) {
+            cacheLimit = parseByteSize(argv[++i]);
+            if (cacheLimit == 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputArg = argv[++i];
+        } else if (strcmp(argv[i], "--width-scale") == 0 && i + 1 < argc) {
+            if (parseCount(argv[++i], 1, &widthScale) != 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+            widthGiven = true;
+        } else if (strcmp(argv[i], "--height-scale") == 0 && i + 1 < argc) {
+            if (parseCount(argv[++i], 1, &heightScale) != 0) {
+                return usageError(argv[0], strings.invalidValue, argv[i - 1], argv[i]);
+            }
+            heightGiven = true;
+        } else if (strcmp(argv[i], "--chars") == 0 && i + 1 < argc) {
+            charsArg = argv[++i];
+        } else if (imagePath == NULL && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+            imagePath = argv[i];
+        } else {
+            return usageError(argv[0], i + 1 == argc && takesValue(argv[i]) ? strings.missingValue : strings.unknownOption,
+                              argv[i], NULL);
+        }
+    }
+    if (charsArg != NULL && snprintf(asciiChars, sizeof(asciiChars), "%s", charsArg) >= (int)sizeof(asciiChars)) {
+        fprintf(stderr, "%s\n", strings.charsError);
+        return -1;
+    }
+    if (dither != ascii::DITHER_NONE && maxMemory > 0) {
+        fprintf(stderr, "%s\n", strings.ditherMemoryError);  // Error diffusion and the Bayer phase would restart every strip
+        return -1;
+    }
+
+    // Batch mode: many inputs in one process, no prompts (default values + flags)
+    if (batchSpec != NULL) {
+        std::vector<std::string> inputs;
+        if (ascii::collectBatchInputs(batchSpec, inputs) != ascii::OK) {
+            fprintf(stderr, strings.batchInputsError, batchSpec);
+            return -1;
+        }
+        ascii::Stats stats;
+        ascii::Options options = makeOptions(widthScale, heightScale, asciiChars, colorChoice, textMode, shapeMatch, dither,
+                                             threads, echo, mmapOutput, statsMode != STATS_OFF || cacheDir != NULL ? &stats : NULL);
+        options.maxMemory = maxMemory;
+        setCacheOptions(options, cacheDir, cacheLimit);
+        int failures = ascii::runBatch(inputs, options, outputDir, batchReport);
+        printf(strings.batchComplete, (int)inputs.size() - failures, failures);
+        printCacheReport(stats, cacheDir, stdout);
+        printStats(stats, statsMode);
+        return failures == 0 ? 0 : -1;
+    }
+
+    // Video mode: plays frames in the terminal, no prompts (default values + flags)
+    if (videoSource != NULL) {
+        ascii::Stats stats;
+        ascii::Options options = makeOptions(widthScale, heightScale, asciiChars, colorChoice, textMode, shapeMatch, dither,
+                                             threads, echo, mmapOutput, statsMode != STATS_OFF ? &stats : NULL);
+        if (options.mode != ascii::MODE_TEXT) {
+            fprintf(stderr, "%s\n", strings.videoModeError);
+            return -1;
+        }
+        if (ascii::playVideo(videoSource, options, strings.videoStatus) != ascii::OK) {
+            fprintf(stderr, "%s\n", strings.videoError);
+            return -1;
+        }
+        printStats(stats, statsMode);
+        return 0;
+    }
+
+    // Viewer mode: pans and zooms the image in the terminal until q, no prompts (default values + flags)
+    if (viewMode) {
+        ascii::Stats stats;
+        ascii::Options options = makeOptions(widthScale, heightScale, asciiChars, colorChoice, textMode, shapeMatch, dither,
+                                             threads, false, false, statsMode != STATS_OFF ? &stats : NULL);
+        if (imagePath == NULL) {
+            return usageError(argv[0], NULL, NULL, NULL);
+        }
+        ascii::Status status = strcmp(imagePath, "-") == 0 ? ascii::ERROR_ARGUMENT : ascii::viewImage(imagePath, options, strings.viewStatus);
+        if (status == ascii::ERROR_LOAD) {
+            fprintf(stderr, "%s\n", strings.loadError);
+            return -1;
+        } else if (status != ascii::OK) {
+            fprintf(stderr, "%s\n", strings.viewError);
+            return -1;
+        }
+        printStats(stats, statsMode);
+        return 0;
+    }
+
+    // Server mode: warm converters answer requests until Ctrl+C, no prompts (flags give the request defaults)
+    if (serveAddress != NULL) {
+        ascii::Options options = makeOptions(widthScale, heightScale, asciiChars, colorChoice, textMode, shapeMatch, dither,
+                                             threads, false, false, NULL);
+        printf(strings.serving, serveAddress);
+        fflush(stdout);
+        if (ascii::serve(serveAddress, options, workers, queueDepth, maxRequest) != ascii::OK) {
+            fprintf(stderr, strings.serveError, serveAddress);
+            return -1;
+        }
+        printf("%s\n", strings.serverStopped);
+        return 0;
+    }
+    
+    // Prompts only ask for the values no flag gave, and only on a terminal: piped, redirected and parallel
+    // runs (xargs -P) never block; prompts and errors go to stderr, and messages too when the result goes to stdout
+    if (imagePath == NULL) {
+        return usageError(argv[0], NULL, NULL, NULL);
+    }
+    bool stdinInput = strcmp(imagePath, "-") == 0;
+    bool interactive = !useDefaults && !stdinInput && isatty(STDIN_FILENO);
+    if (!interactive) {
+        if (useDefaults) {
+            fprintf(outputArg != NULL && strcmp(outputArg, "-") == 0 ? stderr : stdout, "%s\n", strings.usingDefaults);
+        }
+    } else {
+        char input[10];  // Array to hold user input
+        if (!colorGiven) {
+            // Ask the user for the color preference
+            fprintf(stderr, "%s", strings.promptColor);
+            if (readAnswer(input, sizeof(input)) == 0 && sscanf(input, "%d", &colorChoice) != 1) {
+                colorChoice = 0;  // Set to 0 if conversion fails
+            }
+        }
+        if (outputArg == NULL) {
+            // Ask the user for the output file path (used as typed)
+            fprintf(stderr, strings.promptOutput, colorChoice == 1 ? DEFAULT_COLOR_OUTPUT_PATH : DEFAULT_OUTPUT_PATH);
+            readAnswer(userPath, sizeof(userPath));
+            outputArg = userPath;
+        }
+        if (!widthGiven) {
+            // Ask the user for the width scale
+            fprintf(stderr, strings.promptWidth, DEFAULT_WIDTH_SCALE);
+            if (readAnswer(input, sizeof(input)) == 0 && (sscanf(input, "%d", &widthScale) != 1 || widthScale < 1)) {
+                widthScale = DEFAULT_WIDTH_SCALE; // Use default if invalid input
+            }
+        }
+        if (!heightGiven) {
+            // Ask the user for the height scale
+            fprintf(stderr, strings.promptHeight, DEFAULT_HEIGHT_SCALE);
+            if (readAnswer(input, sizeof(input)) == 0 && (sscanf(input, "%d", &heightScale) != 1 || heightScale < 1)) {
+                heightScale = DEFAULT_HEIGHT_SCALE; // Use default if invalid input
+            }
+        }
+        if (charsArg == NULL) {
+            // Ask the user for ASCII characters
+            fprintf(stderr, strings.promptChars, DEFAULT_ASCII_CHARS);
+            if (readAnswer(asciiChars, sizeof(asciiChars)) != 0) {
+                strcpy(asciiChars, DEFAULT_ASCII_CHARS); // Use default if input is empty
+            }
+        }
+    }
+    if (resolveOutputPath(outputArg != NULL ? outputArg : "", colorChoice, outputPath, sizeof(outputPath)) != 0) {
+        fprintf(stderr, "%s\n", strings.pathError);
+        return -1;
+    }
+    FILE* log = strcmp(outputPath, "-") == 0 ? stderr : stdout;  // Keeps stdout for the result
+
+    // Convert image to ASCII version (text in the file and terminal, or a colored image)
+    ascii::Stats stats;
+    ascii::Options options = makeOptions(widthScale, heightScale, asciiChars, colorChoice, textMode, shapeMatch, dither,
+                                         threads, echo, mmapOutput, statsMode != STATS_OFF || cacheDir != NULL ? &stats : NULL);
+    options.maxMemory = maxMemory;
+    setCacheOptions(options, cacheDir, cacheLimit);
+    if (cellsPath != NULL) {
+        size_t length = strlen(cellsPath);
+        if (length < 6 || strcasecmp(cellsPath + length - 6, ".cells") != 0 || length >= sizeof(outputPath)) {
+            fprintf(stderr, "%s\n", strings.cellsNameError);
+            return -1;
+        }
+        strcpy(outputPath, cellsPath);  // The .cells extension selects the cell file
+    }
+    size_t outputLength = strlen(outputPath);
+    if (outputLength >= 6 && strcasecmp(outputPath + outputLength - 6, ".cells") == 0 &&
+        (options.mode == ascii::MODE_BRAILLE || options.mode == ascii::MODE_HALF_BLOCK)) {
+        fprintf(stderr, "%s\n", strings.cellsModeError);
+        return -1;
+    }
+    std::vector<ascii::PyramidLevel> levels;
+    if (pyramidSpec != NULL && parsePyramid(pyramidSpec, outputPath, levels) != 0) {
+        fprintf(stderr, strings.pyramidError, pyramidSpec);
+        return -1;
+    }
+    if (pyramidSpec != NULL && (stdinInput || strcmp(outputPath, "-") == 0)) {
+        fprintf(stderr, "%s\n", strings.pyramidPathError);
+        return -1;
+    }
+    ascii::Status status;
+    if (pyramidSpec != NULL) {
+        status = ascii::convertPyramid(imagePath, levels, options);
+    } else if (stdinInput) {
+        // The encoded image is decoded from memory (cv::imdecode), nothing touches the disk
+        std::vector<unsigned char> encoded;
+        status = readStdin(encoded) == 0 ? ascii::convertEncoded(encoded.data(), encoded.size(), outputPath, options) : ascii::ERROR_LOAD;
+    } else {
+        status = ascii::convertFile(imagePath, outputPath, options);
+    }
+    switch (status) {
+        case ascii::OK:             break;
+        case ascii::ERROR_LOAD:     fprintf(stderr, "%s\n", strings.loadError); return -1;
+        case ascii::ERROR_SIZE:     fprintf(stderr, "%s\n", strings.sizeError); return -1;
+        case ascii::ERROR_OUTPUT:   fprintf(stderr, "%s\n", strings.outputError); return -1;
+        case ascii::ERROR_MEMORY:   fprintf(stderr, "%s\n", strings.memoryError); return -1;
+        default:                    fprintf(stderr, "%s\n", strings.convertError); return -1;
+    }
+    if (pyramidSpec != NULL) {
+        for (size_t k = 0; k < levels.size(); k++) {
+            fprintf(log, strings.levelSaved, levels[k].outputPath.c_str());
+        }
+        fprintf(log, strings.pyramidComplete, (int)levels.size());
+        printStats(stats, statsMode);
+        return 0;
+    }
+    if (options.mode == ascii::MODE_COLOR_IMAGE) {
+        fprintf(log, strings.imageSaved, outputPath);
+    }
+
+    fprintf(log, strings.complete, outputPath); // Success log
+    printCacheReport(stats, cacheDir, log);
+
+    printStats(stats, statsMode);
+
+    return 0; // Success
+}
\ No newline at end of file
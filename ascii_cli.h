@@ -0,0 +1,86 @@
+#ifndef ASCII_CLI_H
+#define ASCII_CLI_H
+
+#include "image2ascii.h"        // For the conversion library (libimage2ascii)
+
+// Every message of the command line front-end, one table per language (main.c, main.br.c)
+// Formats take the arguments named in their comment, in that order, and end in their own breakline;
+// plain messages get one when printed
+struct CliStrings {
+    // Usage
+    const char* help;                 // %1$s program name, %2$d / %3$d default width / height scale, %4$s default charset
+    const char* usage;                // %s program name (no image path or a bad command line)
+    const char* unknownOption;        // %s argument
+    const char* missingValue;         // %s option
+    const char* invalidValue;         // %s option, %s value
+
+    // --self-test
+    const char* selfTestFailed;       // %d mismatches
+    const char* selfTestPassed;
+
+    // --batch
+    const char* batchConverted;       // %s input, %s output
+    const char* batchLoadError;       // %s input
+    const char* batchSizeError;       // %s input
+    const char* batchOutputError;     // %s output
+    const char* batchConvertError;    // %s input
+    const char* batchMemoryError;     // %s input
+    const char* batchInputsError;     // %s --batch argument
+    const char* batchComplete;        // %d converted, %d failed
+
+    // --video, --view and --serve
+    const char* videoStatus;          // Status line of playVideo()
+    const char* videoError;
+    const char* videoModeError;
+    const char* viewStatus;           // Status line of viewImage()
+    const char* viewError;
+    const char* serving;              // %s address
+    const char* serveError;           // %s address
+    const char* serverStopped;
+
+    // Prompts
+    const char* usingDefaults;
+    const char* promptColor;
+    const char* promptOutput;         // %s default output path
+    const char* promptWidth;          // %d default width scale
+    const char* promptHeight;         // %d default height scale
+    const char* promptChars;          // %s default charset
+
+    // Errors of the single image conversion
+    const char* charsError;
+    const char* pathError;
+    const char* cellsNameError;
+    const char* cellsModeError;
+    const char* pyramidError;         // %s --pyramid argument
+    const char* pyramidPathError;
+    const char* loadError;
+    const char* sizeError;
+    const char* outputError;
+    const char* memoryError;
+    const char* ditherMemoryError;
+    const char* convertError;
+
+    // Results
+    const char* levelSaved;           // %s output path
+    const char* pyramidComplete;      // %d levels
+    const char* imageSaved;           // %s output path
+    const char* complete;             // %s output path
+    const char* cacheReport;          // %lld hits, %lld misses
+
+    // --stats report (labels are padded to 14 columns)
+    const char* statsTitle;
+    const char* stageNames[ascii::STAGE_COUNT];
+    const char* statsWall;
+    const char* statsCells;           // Label, and the unit of the rate after it
+    const char* statsCellsRate;
+    const char* statsWritten;
+    const char* statsCache;           // %lld hits, %lld misses
+    const char* statsPeak;
+    const char* statsThread;          // %d thread, %d bands, %.3f busy milliseconds
+};
+
+// Parses the command line and runs the conversion, batch, video, viewer or server it asks for
+// Returns the exit status of the program (0 on success, -1 on error)
+int runCli(int argc, char** argv, const CliStrings& strings);
+
+#endif
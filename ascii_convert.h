@@ -0,0 +1,49 @@
+#ifndef ASCII_CONVERT_H
+#define ASCII_CONVERT_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include "ascii_lut.h"          // For intensity -> glyph tables
+#include "glyph_atlas.h"        // For the pre-rendered glyph masks of color mode
+#include "thread_pool.h"        // For the tile-parallel band scheduler
+#include "image2ascii.h"        // For the library types
+
+// View of a decoded BGR (or gray) cv::Mat for the library calls (no copy)
+// sourceWidth and sourceHeight give the full size of an image decoded reduced, 0 when it is full size
+static inline ascii::ImageView imageViewOfMat(const cv::Mat& image, int sourceWidth = 0, int sourceHeight = 0) {
+    ascii::ImageView view;
+    view.data = image.data;
+    view.width = image.cols;
+    view.height = image.rows;
+    view.stride = image.step;
+    view.format = image.channels() == 1 ? ascii::FORMAT_GRAY8 : ascii::FORMAT_BGR24;
+    view.sourceWidth = sourceWidth;
+    view.sourceHeight = sourceHeight;
+    return view;
+}
+
+// Converts decoded pixels and writes them to outputPath in the format its extension and the mode ask for
+// (colored PNGs strip by strip, never the whole canvas), defined in image2ascii.cpp
+namespace ascii {
+Status writeView(const Converter& converter, const ImageView& view, const char* outputPath);
+}
+
+// Renders the colored canvas (rows * heightScale x cols * widthScale) of the resized image
+// Every pixel is written by exactly one cell, so the canvas needs no black fill
+static inline void renderColorCanvas(const cv::Mat& image, const unsigned char* glyphLUT, const GlyphAtlas* atlas, cv::Mat& output, int threads,
+                                     std::vector<WorkerLoad>* loads = NULL) {
+    int rows = image.rows;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+
+    output.create(rows * atlas->heightScale, image.cols * atlas->widthScale, CV_8UC3); // Canvas
+
+    // Draw ASCII characters on the image (tinted glyph masks), each band owns its canvas rows
+    parallelForBands(bands, threads, [&](int band) {
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            glyphAtlasRenderRow(atlas, image, i, glyphLUT, output);
+        }
+    }, loads);
+}
+
+#endif
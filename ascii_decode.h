@@ -0,0 +1,178 @@
+#ifndef ASCII_DECODE_H
+#define ASCII_DECODE_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // For reading the JPEG header
+#include "image2ascii.h"        // For the library types
+#include "glyph_shape.h"        // For the subcell grid of shape matching
+#include "unicode_cells.h"      // For the dot grid of Braille
+
+// Reads the size of a baseline or progressive JPEG from its frame header (SOFn marker), from the current position of file
+// Returns 0 on success and -1 if the stream is not a JPEG or the header is damaged
+static inline int jpegStreamSize(FILE* file, int* width, int* height) {
+    int status = -1;
+    if (fgetc(file) == 0xFF && fgetc(file) == 0xD8) {
+        for (;;) {
+            int c = fgetc(file);
+            if (c != 0xFF) break;
+            int marker;
+            do {
+                marker = fgetc(file);  // Fill bytes (0xFF) may precede the marker
+            } while (marker == 0xFF);
+            if (marker == EOF || marker == 0xD9 || marker == 0xDA) break;  // End of image or start of scan
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;  // Markers without a length
+
+            int hi = fgetc(file), lo = fgetc(file);
+            if (hi == EOF || lo == EOF) break;
+            int length = (hi << 8) | lo;
+            if (length < 2) break;
+            bool frameHeader = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (frameHeader) {
+                unsigned char header[5];  // Precision, height, width
+                if (fread(header, 1, sizeof(header), file) != sizeof(header)) break;
+                *height = (header[1] << 8) | header[2];
+                *width = (header[3] << 8) | header[4];
+                status = (*width > 0 && *height > 0) ? 0 : -1;
+                break;
+            }
+            if (fseek(file, length - 2, SEEK_CUR) != 0) break;
+        }
+    }
+    return status;
+}
+
+// Size of a JPEG file, see jpegStreamSize()
+static inline int jpegImageSize(const char* path, int* width, int* height) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    int status = jpegStreamSize(file, width, height);
+    fclose(file);
+    return status;
+}
+
+// Size of a JPEG held in memory, see jpegStreamSize()
+static inline int jpegBufferSize(const unsigned char* data, size_t size, int* width, int* height) {
+    if (size < 2 || data[0] != 0xFF || data[1] != 0xD8) {
+        return -1;  // Also spares fmemopen() for other formats
+    }
+    FILE* file = fmemopen((void*)data, size, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    int status = jpegStreamSize(file, width, height);
+    fclose(file);
+    return status;
+}
+
+// Largest power of two reduction, up to limit, that keeps every widthScale x heightScale cell at least one pixel
+static inline int reductionFor(int widthScale, int heightScale, int limit) {
+    int scale = widthScale < heightScale ? widthScale : heightScale;
+    int reduction = 1;
+    while (reduction * 2 <= limit && reduction * 2 <= scale) reduction *= 2;
+    return reduction;
+}
+
+// reductionFor() the cells of options: modes that split cells (shape matching, half blocks, Braille dots)
+// need every subcell to keep at least one pixel
+static inline int reductionForOptions(const ascii::Options& options, int limit) {
+    switch (options.mode) {
+        case ascii::MODE_TEXT:
+            if (options.match == ascii::MATCH_SHAPE) {
+                return reductionFor(options.widthScale / SHAPE_GRID, options.heightScale / SHAPE_GRID, limit);
+            }
+            break;
+        case ascii::MODE_HALF_BLOCK: return reductionFor(options.widthScale, options.heightScale / 2, limit);
+        case ascii::MODE_BRAILLE:    return reductionFor(options.widthScale / BRAILLE_DOTS_X, options.heightScale / BRAILLE_DOTS_Y, limit);
+        default:                     break;
+    }
+    return reductionFor(options.widthScale, options.heightScale, limit);
+}
+
+// Largest decode-time reduction (IMREAD_REDUCED_* factor 2, 4 or 8) that keeps every cell of options at least one pixel
+static inline int decodeReductionForOptions(const ascii::Options& options) {
+    return reductionForOptions(options, 8);
+}
+
+// Modes that only read intensities decode gray (a third of the pixel bytes)
+static inline bool decodesGray(const ascii::Options& options) {
+    return options.mode == ascii::MODE_TEXT || options.mode == ascii::MODE_BRAILLE;
+}
+
+// cv::imread / cv::imdecode flags of a reduction (1, 2, 4 or 8), gray or BGR
+static inline int reducedReadFlags(int reduction, bool gray) {
+    switch (reduction) {
+        case 8:  return gray ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+        case 4:  return gray ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+        case 2:  return gray ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+        default: return gray ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+    }
+}
+
+// Full image size of a decoded image, from the JPEG header size (width x height) and the reduction
+// libjpeg rounds reduced sizes up, EXIF orientation may swap them, anything else falls back to the decoded size
+static inline void reducedSourceSize(const cv::Mat& image, int width, int height, int reduction, int* sourceWidth, int* sourceHeight) {
+    int expectedWidth = (width + reduction - 1) / reduction;
+    int expectedHeight = (height + reduction - 1) / reduction;
+    if (reduction > 1 && image.cols == expectedWidth && image.rows == expectedHeight) {
+        *sourceWidth = width;
+        *sourceHeight = height;
+    } else if (reduction > 1 && image.cols == expectedHeight && image.rows == expectedWidth) {
+        *sourceWidth = height;
+        *sourceHeight = width;
+    } else {
+        *sourceWidth = image.cols * reduction;
+        *sourceHeight = image.rows * reduction;
+    }
+}
+
+// Decodes an image reduced by reduction (1, 2, 4 or 8), gray or BGR; only JPEGs are decoded reduced (by libjpeg, the
+// full-size image is never allocated), reduction gets 1 for other formats
+// sourceWidth and sourceHeight get the size of the full image, the character grid is computed from it
+// Returns an empty image if the file cannot be read
+static inline cv::Mat decodeReduced(const char* path, int* reduction, bool gray, int* sourceWidth, int* sourceHeight) {
+    int width = 0, height = 0;
+    if (jpegImageSize(path, &width, &height) != 0) {
+        *reduction = 1;
+    }
+    cv::Mat image;
+    try {
+        image = cv::imread(path, reducedReadFlags(*reduction, gray));
+    } catch (const cv::Exception&) {
+        image.release();
+    }
+    if (!image.empty()) {
+        reducedSourceSize(image, width, height, *reduction, sourceWidth, sourceHeight);
+    }
+    return image;
+}
+
+// Decodes an image for conversion at the smallest size that still covers every cell
+// Plain text and Braille decode gray only (see decodeReduced())
+static inline cv::Mat decodeForCells(const char* path, const ascii::Options& options, int* sourceWidth, int* sourceHeight) {
+    int reduction = decodeReductionForOptions(options);
+    return decodeReduced(path, &reduction, decodesGray(options), sourceWidth, sourceHeight);
+}
+
+// decodeForCells() for encoded image bytes held in memory (cv::imdecode)
+static inline cv::Mat decodeBufferForCells(const unsigned char* data, size_t size, const ascii::Options& options,
+                                           int* sourceWidth, int* sourceHeight) {
+    int width = 0, height = 0;
+    int reduction = 1;
+    if (jpegBufferSize(data, size, &width, &height) == 0) {
+        reduction = decodeReductionForOptions(options);
+    }
+    cv::Mat image;
+    try {
+        image = cv::imdecode(cv::Mat(1, (int)size, CV_8UC1, (void*)data), reducedReadFlags(reduction, decodesGray(options)));
+    } catch (const cv::Exception&) {
+        image.release();
+    }
+    if (!image.empty()) {
+        reducedSourceSize(image, width, height, reduction, sourceWidth, sourceHeight);
+    }
+    return image;
+}
+
+#endif
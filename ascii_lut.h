@@ -0,0 +1,173 @@
+#ifndef ASCII_LUT_H
+#define ASCII_LUT_H
+
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+
+// SIMD kernels are only built for x86 with GCC/Clang (runtime dispatch picks the best one)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>          // For SSE4.1 / AVX2 intrinsics
+#define ASCII_LUT_X86 1
+#endif
+
+#define GLYPH_LUT_SIZE 256      // One entry per possible intensity (0 - 255)
+
+// Fixed-point BT.601 luma weights (same as cv::cvtColor BGR2GRAY), 14 fractional bits
+#define LUMA_WEIGHT_B 1868
+#define LUMA_WEIGHT_G 9617
+#define LUMA_WEIGHT_R 4899
+#define LUMA_SHIFT    14
+
+// Fuction for maping intensity for ASCII characters
+// The value can be between 0 and 255
+// Reference version (one pixel at a time), the LUT below must always match it
+static inline char intensityToASCII(int intensity, const char* asciiChars) {
+    int len = strlen(asciiChars);
+    return asciiChars[(intensity * (len - 1)) / 255];
+}
+
+// Builds the intensity -> glyph table once per charset
+// An empty charset maps everything to a space instead of reading before the string
+static inline void buildGlyphLUT(const char* asciiChars, unsigned char lut[GLYPH_LUT_SIZE]) {
+    int len = strlen(asciiChars);
+    for (int i = 0; i < GLYPH_LUT_SIZE; i++) {
+        lut[i] = (len > 0) ? (unsigned char)asciiChars[(i * (len - 1)) / 255] : ' ';
+    }
+}
+
+// Intensity of a BGR color, rounded like cv::cvtColor
+static inline unsigned int colorIntensity(unsigned int b, unsigned int g, unsigned int r) {
+    return (b * LUMA_WEIGHT_B + g * LUMA_WEIGHT_G + r * LUMA_WEIGHT_R + (1 << (LUMA_SHIFT - 1))) >> LUMA_SHIFT;
+}
+
+// Glyph of a BGR cell color: every mode that picks glyphs by brightness goes through this intensity
+static inline unsigned char colorToGlyph(const unsigned char* bgr, const unsigned char* lut) {
+    return lut[colorIntensity(bgr[0], bgr[1], bgr[2])];
+}
+
+// Row kernel signature: maps n intensities from src to glyphs in dst
+typedef void (*GlyphRowKernel)(const unsigned char* src, char* dst, int n, const unsigned char* lut);
+
+// Scalar fallback (one table load per pixel, no strlen or divide)
+static inline void mapRowToASCIIScalar(const unsigned char* src, char* dst, int n, const unsigned char* lut) {
+    for (int j = 0; j < n; j++) {
+        dst[j] = (char)lut[src[j]];
+    }
+}
+
+#ifdef ASCII_LUT_X86
+// SSE4.1 kernel: the 256 entry table is split in 16 sub-tables of 16 bytes
+// pshufb looks up the low nibble in every sub-table and blendv keeps the one selected by the high nibble
+__attribute__((target("sse4.1")))
+static void mapRowToASCIISSE4(const unsigned char* src, char* dst, int n, const unsigned char* lut) {
+    __m128i tables[16];
+    for (int k = 0; k < 16; k++) {
+        tables[k] = _mm_loadu_si128((const __m128i*)(lut + 16 * k));
+    }
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + j));
+        __m128i lo = _mm_and_si128(pixels, lowMask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(pixels, 4), lowMask);
+        __m128i result = _mm_setzero_si128();
+        for (int k = 0; k < 16; k++) {
+            __m128i select = _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)k));
+            result = _mm_blendv_epi8(result, _mm_shuffle_epi8(tables[k], lo), select);
+        }
+        _mm_storeu_si128((__m128i*)(dst + j), result);
+    }
+    mapRowToASCIIScalar(src + j, dst + j, n - j, lut);  // Tail
+}
+
+// AVX2 kernel: same scheme on 32 pixels, sub-tables broadcast to both 128-bit lanes
+__attribute__((target("avx2")))
+static void mapRowToASCIIAVX2(const unsigned char* src, char* dst, int n, const unsigned char* lut) {
+    __m256i tables[16];
+    for (int k = 0; k < 16; k++) {
+        tables[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(lut + 16 * k)));
+    }
+    const __m256i lowMask = _mm256_set1_epi8(0x0F);
+
+    int j = 0;
+    for (; j + 32 <= n; j += 32) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + j));
+        __m256i lo = _mm256_and_si256(pixels, lowMask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(pixels, 4), lowMask);
+        __m256i result = _mm256_setzero_si256();
+        for (int k = 0; k < 16; k++) {
+            __m256i select = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)k));
+            result = _mm256_blendv_epi8(result, _mm256_shuffle_epi8(tables[k], lo), select);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + j), result);
+    }
+    mapRowToASCIISSE4(src + j, dst + j, n - j, lut);  // Tail (AVX2 implies SSE4.1)
+}
+#endif
+
+// Picks the best kernel supported by the running CPU
+static inline GlyphRowKernel selectGlyphRowKernel(void) {
+#ifdef ASCII_LUT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return mapRowToASCIIAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return mapRowToASCIISSE4;
+    }
+#endif
+    return mapRowToASCIIScalar;
+}
+
+// Maps a whole row of intensities to glyphs (dispatch is resolved once)
+static inline void mapRowToASCII(const unsigned char* src, char* dst, int n, const unsigned char* lut) {
+    static const GlyphRowKernel kernel = selectGlyphRowKernel();
+    kernel(src, dst, n, lut);
+}
+
+// Checks every kernel available on this CPU against intensityToASCII
+// Covers every charset length from 1 to 100 and every intensity, returns the number of mismatches
+static inline int glyphLUTSelfTest(void) {
+    GlyphRowKernel kernels[3] = {mapRowToASCIIScalar, NULL, NULL};
+    const char* kernelNames[3] = {"scalar", "sse4.1", "avx2"};
+#ifdef ASCII_LUT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) kernels[1] = mapRowToASCIISSE4;
+    if (__builtin_cpu_supports("avx2")) kernels[2] = mapRowToASCIIAVX2;
+#endif
+
+    // Every intensity twice plus an odd tail, so both the vector body and the scalar tail run
+    const int n = 2 * GLYPH_LUT_SIZE + 19;
+    unsigned char src[n];
+    char dst[n];
+    for (int j = 0; j < n; j++) {
+        src[j] = (unsigned char)((j * 7) % GLYPH_LUT_SIZE);
+    }
+
+    int failures = 0;
+    char asciiChars[101];
+    unsigned char lut[GLYPH_LUT_SIZE];
+    for (int len = 1; len <= 100; len++) {
+        for (int c = 0; c < len; c++) {
+            asciiChars[c] = (char)(' ' + (c * 37) % 95);  // Printable, unordered charset
+        }
+        asciiChars[len] = '\0';
+        buildGlyphLUT(asciiChars, lut);
+
+        for (int k = 0; k < 3; k++) {
+            if (kernels[k] == NULL) continue;
+            kernels[k](src, dst, n, lut);
+            for (int j = 0; j < n; j++) {
+                if (dst[j] != intensityToASCII(src[j], asciiChars)) {
+                    printf("Mismatch: kernel %s, charset length %d, intensity %d\n", kernelNames[k], len, src[j]);
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+#endif
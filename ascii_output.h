@@ -0,0 +1,213 @@
+#ifndef ASCII_OUTPUT_H
+#define ASCII_OUTPUT_H
+
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <errno.h>              // For EINTR retries
+#include <fcntl.h>              // For open()
+#include <unistd.h>             // For write() / ftruncate()
+#include <limits.h>             // For IOV_MAX
+#include <sys/mman.h>           // For mmap()
+#include <sys/uio.h>            // For writev()
+#include <vector>               // For the escape buffers
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024            // POSIX minimum is 16, every Linux/BSD kernel accepts 1024
+#endif
+
+// * Output flags
+#define OUTPUT_ECHO_TERMINAL 1  // Also send the frame to the terminal (stdout)
+#define OUTPUT_MMAP_FILE     2  // Write the file through an mmap'd region sized up front
+
+#define OUTPUT_STDOUT_PATH   "-"  // Output path that stands for standard output (pipelines)
+
+// Frame sink: the whole text frame lives in one preallocated buffer (cols + 1 bytes per row)
+// and is sent with a single write() per destination instead of one stdio call per character
+typedef struct {
+    char* buffer;    // Frame bytes, rows * (cols + 1)
+    size_t size;     // Frame size in bytes
+    int rows;        // Text rows
+    int cols;        // Characters per row (without the breakline)
+    int fileFd;      // Output file descriptor, -1 if there is no file
+    int flags;       // OUTPUT_* flags
+    int mapped;      // 1 if buffer is the mmap'd file itself
+} FrameWriter;
+
+// True if path is OUTPUT_STDOUT_PATH
+static inline int isStdoutPath(const char* path) {
+    return path != NULL && strcmp(path, OUTPUT_STDOUT_PATH) == 0;
+}
+
+// Opens path for writing (created or truncated), or a duplicate of standard output for OUTPUT_STDOUT_PATH,
+// so the caller closes both alike; returns the descriptor or -1 on error
+static inline int openOutput(const char* path) {
+    return isStdoutPath(path) ? dup(STDOUT_FILENO) : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+// Writes every byte, retrying on short writes (pipes) and EINTR
+static inline int writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+// Writes every chunk in order with writev(), retrying on short writes and EINTR (iov is modified)
+// Returns 0 on success and -1 on error
+static inline int writevAll(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count < IOV_MAX ? count : IOV_MAX);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Skip the chunks that were fully written and advance inside the partial one
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    return 0;
+}
+
+// Sends variable-size chunks (e.g., parallel bands) with one writev() to path and one to the terminal
+// path can be NULL for terminal only output, flags are the OUTPUT_* flags (OUTPUT_MMAP_FILE is ignored)
+// Returns 0 on success and -1 on error
+static inline int writeChunks(const char* path, const struct iovec* chunks, int count, int flags) {
+    struct iovec* iov = (struct iovec*)malloc(sizeof(struct iovec) * (count > 0 ? count : 1));
+    if (iov == NULL) {
+        return -1;
+    }
+
+    int status = 0;
+    if (path != NULL) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        memcpy(iov, chunks, sizeof(struct iovec) * count);
+        if (fd < 0 || writevAll(fd, iov, count) != 0) status = -1;
+        if (fd >= 0 && close(fd) != 0) status = -1;
+    }
+    if (flags & OUTPUT_ECHO_TERMINAL) {
+        fflush(stdout);  // Keep order with the printf logs already buffered
+        memcpy(iov, chunks, sizeof(struct iovec) * count);
+        if (writevAll(STDOUT_FILENO, iov, count) != 0) status = -1;
+    }
+    free(iov);
+    return status;
+}
+
+// Creates (or truncates) path and writes data with a single write() loop
+// Returns 0 on success and -1 on error
+static inline int writeFileAll(const char* path, const char* data, size_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    int status = writeAll(fd, data, size);
+    if (close(fd) != 0) status = -1;
+    return status;
+}
+
+// Opens the sink for a rows x cols frame, path can be NULL for terminal only output
+// Returns 0 on success and -1 on error
+static inline int frameWriterOpen(FrameWriter* writer, const char* path, int rows, int cols, int flags) {
+    memset(writer, 0, sizeof(*writer));
+    writer->rows = rows;
+    writer->cols = cols;
+    writer->flags = flags;
+    writer->fileFd = -1;
+    writer->size = (size_t)rows * (size_t)(cols + 1);
+
+    if (path != NULL) {
+        int openFlags = O_CREAT | O_TRUNC | ((flags & OUTPUT_MMAP_FILE) ? O_RDWR : O_WRONLY);
+        writer->fileFd = open(path, openFlags, 0644);
+        if (writer->fileFd < 0) {
+            return -1;
+        }
+    }
+
+    // With --mmap the frame is built straight into the file pages (no extra copy and no write)
+    if (writer->fileFd >= 0 && (flags & OUTPUT_MMAP_FILE) && writer->size > 0) {
+        if (ftruncate(writer->fileFd, (off_t)writer->size) == 0) {
+            void* region = mmap(NULL, writer->size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->fileFd, 0);
+            if (region != MAP_FAILED) {
+                writer->buffer = (char*)region;
+                writer->mapped = 1;
+            }
+        }
+    }
+    if (!writer->mapped) {
+        writer->buffer = (char*)malloc(writer->size > 0 ? writer->size : 1);
+        if (writer->buffer == NULL) {
+            if (writer->fileFd >= 0) close(writer->fileFd);
+            writer->fileFd = -1;
+            return -1;
+        }
+    }
+
+    // Breaklines are fixed, rows only have to fill their cols bytes
+    for (int i = 0; i < rows; i++) {
+        writer->buffer[(size_t)i * (cols + 1) + cols] = '\n';
+    }
+    return 0;
+}
+
+// Returns where row i has to be written (cols bytes)
+static inline char* frameWriterRow(FrameWriter* writer, int i) {
+    return writer->buffer + (size_t)i * (writer->cols + 1);
+}
+
+// Sends the frame: one write() to the file (skipped when mmap'd) and one to the terminal
+// Returns 0 on success and -1 on error
+static inline int frameWriterFlush(FrameWriter* writer) {
+    int status = 0;
+    if (writer->fileFd >= 0 && !writer->mapped) {
+        if (writeAll(writer->fileFd, writer->buffer, writer->size) != 0) status = -1;
+    }
+    if (writer->flags & OUTPUT_ECHO_TERMINAL) {
+        fflush(stdout);  // Keep order with the printf logs already buffered
+        if (writeAll(STDOUT_FILENO, writer->buffer, writer->size) != 0) status = -1;
+    }
+    return status;
+}
+
+// Appends bytes to an escape buffer (terminal frames sent with one write())
+static inline void appendBytes(std::vector<char>& out, const char* data, size_t size) {
+    out.insert(out.end(), data, data + size);
+}
+
+// Appends the cursor-addressing escape for a 0-based row and column
+static inline void appendCursorTo(std::vector<char>& out, int row, int col) {
+    char escape[32];
+    int size = snprintf(escape, sizeof(escape), "\033[%d;%dH", row + 1, col + 1);
+    appendBytes(out, escape, (size_t)size);
+}
+
+// Releases the buffer and closes the file
+// Returns 0 on success and -1 if the file could not be finished
+static inline int frameWriterClose(FrameWriter* writer) {
+    int status = 0;
+    if (writer->mapped) {
+        if (munmap(writer->buffer, writer->size) != 0) status = -1;
+    } else {
+        free(writer->buffer);
+    }
+    if (writer->fileFd >= 0 && close(writer->fileFd) != 0) status = -1;
+    writer->buffer = NULL;
+    writer->fileFd = -1;
+    writer->mapped = 0;
+    return status;
+}
+
+#endif
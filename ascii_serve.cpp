@@ -0,0 +1,336 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For free()
+#include <string.h>             // For string manipulation
+#include <signal.h>             // For stopping on Ctrl+C / SIGTERM
+#include <fcntl.h>              // For the non-blocking wake-up pipe
+#include <poll.h>               // For watching idle connections and the stop flag
+#include <sys/socket.h>         // For the socket timeouts
+#include <list>                 // For the converter use order
+#include <memory>               // For converters shared with in-flight requests
+#include <mutex>                // For the converter cache and the returned connections
+#include <string>               // For the converter keys
+#include <thread>               // For the worker pool
+#include <unordered_map>        // For the warm converters
+#include <vector>               // For request and response bytes
+#include "image2ascii.h"        // For the library API
+#include "ascii_convert.h"      // For imageViewOfMat()
+#include "ascii_decode.h"       // For decode-time reduction
+#include "pipeline.h"           // For the bounded request queue
+#include "serve_protocol.h"     // For the wire format and sockets
+#include "strip_io.h"           // For strip-wise PNG encoding of colored replies
+#include "thread_pool.h"        // For defaultThreadCount() and monotonicSeconds()
+
+#define SERVE_CONVERTER_CACHE 16  // Warm converters kept (one per mode, scales and charset combination)
+#define SERVE_POLL_MS         250 // How often the poller looks at the stop flag and the idle timeouts
+#define SERVE_IDLE_SECONDS    60  // Connections without a new request for this long are closed
+#define SERVE_IO_SECONDS      10  // Longest wait for the rest of a started request, or for the client to take a reply
+#define SERVE_STRIP_ROWS      8   // Text rows of a colored reply rendered per PNG strip
+#define SERVE_READ_CHUNK      (1 << 20)   // Image bytes read at once, the buffer only grows as they arrive
+#define SERVE_KEEP_BUFFER     (16 << 20)  // Larger request and reply buffers are freed instead of kept by the worker
+
+namespace ascii {
+
+static volatile sig_atomic_t serveStopRequested = 0;
+
+static void serveStopHandler(int) {
+    serveStopRequested = 1;
+}
+
+// Warm converters shared by every worker, built on the first request of an option set
+// A full cache drops the least recently used one; converters are const and kept alive by in-flight requests
+class ConverterCache {
+public:
+    std::shared_ptr<const Converter> get(const Options& options) {
+        char scales[32];
+        snprintf(scales, sizeof(scales), "%d:%d:%d:", (int)options.mode, options.widthScale, options.heightScale);
+        std::string key = scales + options.asciiChars;
+
+        std::lock_guard<std::mutex> guard(lock_);
+        std::unordered_map<std::string, Order::iterator>::iterator found = index_.find(key);
+        if (found != index_.end()) {
+            order_.splice(order_.begin(), order_, found->second);  // Most recently used first
+            return found->second->second;
+        }
+        std::shared_ptr<const Converter> converter(new Converter(options));
+        order_.push_front(std::make_pair(key, converter));
+        index_[key] = order_.begin();
+        while (order_.size() > SERVE_CONVERTER_CACHE) {
+            index_.erase(order_.back().first);
+            order_.pop_back();
+        }
+        return converter;
+    }
+
+private:
+    typedef std::list<std::pair<std::string, std::shared_ptr<const Converter> > > Order;
+    std::mutex lock_;
+    Order order_;
+    std::unordered_map<std::string, Order::iterator> index_;
+};
+
+// Colored reply: the canvas is rendered and PNG-encoded SERVE_STRIP_ROWS text rows at a time into memory,
+// so a request holds one strip instead of the whole canvas (the same encoder as colored file output)
+static Status serveColorPNG(const Converter& converter, const ImageView& view, int cols, int rows, std::vector<unsigned char>& reply) {
+    const Options& options = converter.options();
+    char* bytes = NULL;
+    size_t size = 0;
+    StripWriter writer;
+    if (stripWriterOpenFile(&writer, open_memstream(&bytes, &size), cols * options.widthScale, rows * options.heightScale) != 0) {
+        free(bytes);
+        return ERROR_CONVERT;
+    }
+
+    int stripRows = rows < SERVE_STRIP_ROWS ? rows : SERVE_STRIP_ROWS;
+    size_t stride = (size_t)cols * options.widthScale * 3;
+    std::vector<unsigned char> strip((size_t)stripRows * options.heightScale * stride);
+    Status status = OK;
+    for (int first = 0; first < rows && status == OK; first += stripRows) {
+        int count = first + stripRows < rows ? stripRows : rows - first;
+        ImageSpan span = {strip.data(), cols * options.widthScale, count * options.heightScale, stride};
+        status = converter.renderColorRows(view, first, count, span);
+        if (status == OK && stripWriterRows(&writer, strip.data(), stride, span.height) != 0) {
+            status = ERROR_CONVERT;
+        }
+    }
+    if (status != OK) {
+        stripWriterAbort(&writer);
+    } else if (stripWriterClose(&writer) != 0) {
+        status = ERROR_CONVERT;
+    } else {
+        reply.assign(bytes, bytes + size);
+    }
+    free(bytes);
+    return status;
+}
+
+// Converts the image bytes of one request into reply (text, ANSI text or PNG)
+static Status serveConvert(ConverterCache& cache, const Options& defaults, const ServeRequest& request,
+                           const std::string& charset, const std::vector<unsigned char>& image, std::vector<unsigned char>& reply) {
+    if (request.mode > MODE_BRAILLE || image.empty()) {
+        return ERROR_ARGUMENT;
+    }
+    Options options = defaults;
+    options.mode = (Mode)request.mode;
+    if (request.widthScale > 0) options.widthScale = (int)request.widthScale;
+    if (request.heightScale > 0) options.heightScale = (int)request.heightScale;
+    if (!charset.empty()) options.asciiChars = charset;
+    options.threads = 1;  // Requests run in parallel on the workers, not inside
+    options.echo = false;
+    options.stats = NULL;
+
+    int sourceWidth, sourceHeight;
+    cv::Mat decoded = decodeBufferForCells(image.data(), image.size(), options, &sourceWidth, &sourceHeight);
+    if (decoded.empty()) {
+        return ERROR_LOAD;
+    }
+    std::shared_ptr<const Converter> converter = cache.get(options);
+    ImageView view = imageViewOfMat(decoded, sourceWidth, sourceHeight);
+    int cols, rows;
+    Status status = converter->gridSize(view, &cols, &rows);
+    if (status != OK) {
+        return status;
+    }
+
+    if (options.mode == MODE_COLOR_IMAGE) {
+        return serveColorPNG(*converter, view, cols, rows, reply);
+    }
+
+    reply.resize(converter->maxTextSize(view));
+    Span span = {(char*)reply.data(), reply.size()};
+    size_t written = 0;
+    status = converter->convertText(view, span, &written);
+    reply.resize(status == OK ? written : 0);
+    return status;
+}
+
+// Reads the length image bytes of a request in SERVE_READ_CHUNK pieces, so a declared length only costs memory
+// once the client actually sends it; returns 0 on success and -1 when the client stops short
+static int serveReadImage(int fd, unsigned long long length, std::vector<unsigned char>& image) {
+    image.clear();
+    for (unsigned long long done = 0; done < length;) {
+        size_t chunk = length - done < SERVE_READ_CHUNK ? (size_t)(length - done) : SERVE_READ_CHUNK;
+        image.resize((size_t)done + chunk);
+        if (readAll(fd, image.data() + done, chunk) != 0) return -1;
+        done += chunk;
+    }
+    return 0;
+}
+
+// Frees a worker buffer that one large request grew past SERVE_KEEP_BUFFER (workers keep theirs between requests)
+static void serveTrimBuffer(std::vector<unsigned char>& buffer) {
+    if (buffer.capacity() > SERVE_KEEP_BUFFER) {
+        std::vector<unsigned char>().swap(buffer);
+    }
+}
+
+// Answers one request of a connection that has bytes waiting (a worker never waits for an idle client)
+// Returns 0 to keep the connection for its next request, -1 when it must be closed (client gone or malformed header)
+static int serveRequest(int fd, ConverterCache& cache, const Options& defaults, unsigned long long maxImage, std::string& charset,
+                        std::vector<unsigned char>& image, std::vector<unsigned char>& reply) {
+    unsigned char header[SERVE_REQUEST_SIZE];
+    ServeRequest request;
+    if (readAll(fd, header, sizeof(header)) != 0) return -1;
+    bool valid = serveDecodeRequest(header, &request, maxImage) == 0;
+    Status status = ERROR_ARGUMENT;
+    if (valid) {
+        charset.resize(request.charsetLength);
+        if ((request.charsetLength > 0 && readAll(fd, &charset[0], charset.size()) != 0) ||
+            serveReadImage(fd, request.imageLength, image) != 0) {
+            return -1;
+        }
+        status = serveConvert(cache, defaults, request, charset, image, reply);
+    }
+    if (status != OK) {
+        reply.clear();
+    }
+
+    ServeResponse response = {status, (unsigned long long)reply.size()};
+    unsigned char responseHeader[SERVE_RESPONSE_SIZE];
+    serveEncodeResponse(&response, responseHeader);
+    if (writeAll(fd, (const char*)responseHeader, sizeof(responseHeader)) != 0 ||
+        (!reply.empty() && writeAll(fd, (const char*)reply.data(), reply.size()) != 0) || !valid) {
+        return -1;  // The rest of a malformed stream cannot be framed
+    }
+    return 0;
+}
+
+// Connection between two requests, watched by the poller
+struct IdleConnection {
+    int fd;
+    double since;  // monotonicSeconds() of its last request (or of accept())
+};
+
+Status serve(const char* address, const Options& options, int workers, int queueDepth, unsigned long long maxImage) {
+    if (workers < 1) workers = defaultThreadCount();
+    if (queueDepth < 1) queueDepth = workers;
+    if (maxImage == 0) maxImage = SERVE_MAX_IMAGE;
+    int listener = serveSocket(address, true, queueDepth);
+    if (listener < 0) {
+        return ERROR_NETWORK;
+    }
+    int wake[2];  // Workers hand connections back to the poller through returned, a byte here interrupts poll()
+    if (pipe(wake) != 0) {
+        close(listener);
+        return ERROR_NETWORK;
+    }
+    fcntl(wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake[1], F_SETFL, O_NONBLOCK);
+
+    serveStopRequested = 0;
+    void (*previousInt)(int) = signal(SIGINT, serveStopHandler);
+    void (*previousTerm)(int) = signal(SIGTERM, serveStopHandler);
+    void (*previousPipe)(int) = signal(SIGPIPE, SIG_IGN);  // A client gone mid-response must not kill the server
+
+    // Workers take requests, not connections: the poller watches every idle connection and queues the ones with
+    // bytes waiting, a worker answers one request and hands the connection back, so idle keep-alive clients
+    // never hold a worker. When the queue is full the poller stops polling and accepting, and new clients wait
+    // in the listen backlog (backpressure instead of unbounded threads)
+    BoundedQueue<int> ready((size_t)queueDepth);
+    std::mutex returnedLock;
+    std::vector<int> returned;
+    ConverterCache cache;
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; w++) {
+        pool.push_back(std::thread([&] {
+            std::string charset;
+            std::vector<unsigned char> image, reply;
+            int fd;
+            while (ready.pop(fd)) {
+                int kept = serveStopRequested ? -1 : serveRequest(fd, cache, options, maxImage, charset, image, reply);
+                serveTrimBuffer(image);
+                serveTrimBuffer(reply);
+                if (kept != 0) {
+                    close(fd);
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> guard(returnedLock);
+                    returned.push_back(fd);
+                }
+                char byte = 0;
+                if (write(wake[1], &byte, 1) < 0) {
+                    // A full pipe already holds a wake-up
+                }
+            }
+        }));
+    }
+
+    std::vector<IdleConnection> idle, next;
+    std::vector<struct pollfd> entries;
+    while (!serveStopRequested) {
+        entries.clear();
+        struct pollfd listenEntry = {listener, POLLIN, 0}, wakeEntry = {wake[0], POLLIN, 0};
+        entries.push_back(listenEntry);
+        entries.push_back(wakeEntry);
+        for (size_t k = 0; k < idle.size(); k++) {
+            struct pollfd entry = {idle[k].fd, POLLIN, 0};
+            entries.push_back(entry);
+        }
+        int count = poll(entries.data(), entries.size(), SERVE_POLL_MS);
+        if (count < 0 && errno != EINTR) break;
+        double now = monotonicSeconds();
+
+        // Readable (or hung up, the worker sees the end) connections become requests, the rest wait or time out
+        next.clear();
+        for (size_t k = 0; k < idle.size(); k++) {
+            if (count > 0 && entries[k + 2].revents != 0) {
+                if (!ready.push(idle[k].fd)) close(idle[k].fd);
+            } else if (now - idle[k].since > SERVE_IDLE_SECONDS) {
+                close(idle[k].fd);
+            } else {
+                next.push_back(idle[k]);
+            }
+        }
+        idle.swap(next);
+
+        if (count > 0 && entries[1].revents != 0) {
+            char bytes[64];
+            while (read(wake[0], bytes, sizeof(bytes)) > 0) {
+            }
+        }
+        {
+            std::lock_guard<std::mutex> guard(returnedLock);
+            for (size_t k = 0; k < returned.size(); k++) {
+                IdleConnection connection = {returned[k], now};
+                idle.push_back(connection);
+            }
+            returned.clear();
+        }
+        if (count > 0 && entries[0].revents != 0) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0) {
+                // A started request that stalls fails its worker's read or write instead of holding it
+                struct timeval timeout = {SERVE_IO_SECONDS, 0};
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                IdleConnection connection = {fd, now};
+                idle.push_back(connection);
+            }
+        }
+    }
+    ready.close();
+    for (size_t w = 0; w < pool.size(); w++) {
+        pool[w].join();
+    }
+    for (size_t k = 0; k < idle.size(); k++) {
+        close(idle[k].fd);
+    }
+    for (size_t k = 0; k < returned.size(); k++) {
+        close(returned[k]);
+    }
+    close(wake[0]);
+    close(wake[1]);
+
+    close(listener);
+    char host[256], port[16];
+    if (serveTcpAddress(address, host, sizeof(host), port, sizeof(port)) != 0) {
+        unlink(address);
+    }
+    signal(SIGINT, previousInt);
+    signal(SIGTERM, previousTerm);
+    signal(SIGPIPE, previousPipe);
+    return OK;
+}
+
+}  // namespace ascii
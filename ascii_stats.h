@@ -0,0 +1,71 @@
+#ifndef ASCII_STATS_H
+#define ASCII_STATS_H
+
+#include <sys/resource.h>       // For the peak resident memory
+#include <vector>               // For the worker loads
+#include "image2ascii.h"        // For ascii::Stats
+#include "thread_pool.h"        // For the monotonic clock and worker loads
+
+// Start time of a stage, the clock is only read when stats are measured
+static inline double stageStart(const ascii::Stats* stats) {
+    return stats != NULL ? monotonicSeconds() : 0.0;
+}
+
+// Adds the time since start to a stage
+static inline void stageEnd(ascii::Stats* stats, ascii::Stage stage, double start) {
+    if (stats != NULL) {
+        stats->stageSeconds[stage] += monotonicSeconds() - start;
+    }
+}
+
+// Worker loads to fill during a parallel stage, NULL when stats are not measured
+static inline std::vector<WorkerLoad>* workerLoadsFor(const ascii::Stats* stats, std::vector<WorkerLoad>& loads) {
+    return stats != NULL ? &loads : NULL;
+}
+
+// Adds the worker loads of one parallel stage to the per-thread totals
+static inline void addWorkerLoads(ascii::Stats* stats, const std::vector<WorkerLoad>& loads) {
+    if (stats == NULL) return;
+    if (stats->threads.size() < loads.size()) {
+        ascii::ThreadStats idle = {0, 0.0};
+        stats->threads.resize(loads.size(), idle);
+    }
+    for (size_t t = 0; t < loads.size(); t++) {
+        stats->threads[t].bands += loads[t].bands;
+        stats->threads[t].busySeconds += loads[t].busySeconds;
+    }
+}
+
+// Adds the counters of a Stats filled on another thread (stage times add up, so overlapping stages count twice)
+static inline void mergeStats(ascii::Stats* stats, const ascii::Stats& from) {
+    if (stats == NULL) return;
+    for (int s = 0; s < ascii::STAGE_COUNT; s++) stats->stageSeconds[s] += from.stageSeconds[s];
+    stats->images += from.images;
+    stats->cells += from.cells;
+    stats->bytesWritten += from.bytesWritten;
+    stats->cacheHits += from.cacheHits;
+    stats->cacheMisses += from.cacheMisses;
+    if (stats->threads.size() < from.threads.size()) {
+        ascii::ThreadStats idle = {0, 0.0};
+        stats->threads.resize(from.threads.size(), idle);
+    }
+    for (size_t t = 0; t < from.threads.size(); t++) {
+        stats->threads[t].bands += from.threads[t].bands;
+        stats->threads[t].busySeconds += from.threads[t].busySeconds;
+    }
+}
+
+// Peak resident memory of the process in KB (0 if unknown)
+static inline long peakRSSKB(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+    return usage.ru_maxrss;         // KB on Linux and the BSDs
+#endif
+}
+
+#endif
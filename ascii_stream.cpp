@@ -0,0 +1,196 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+#include <sys/stat.h>           // For the size of written images
+#include <vector>               // For the strip buffers
+#include "image2ascii.h"        // For the library API
+#include "ascii_decode.h"       // For the decode-time reduction factor
+#include "ascii_output.h"       // For writeAll()
+#include "ascii_stats.h"        // For stage timers
+#include "cell_average.h"       // For the cell bounds
+#include "cell_file.h"          // For cell file output
+#include "strip_encoder.h"      // For the threaded strip-wise PNG encoder
+#include "strip_io.h"           // For strip decoding
+
+namespace ascii {
+
+// Bytes one text row needs in every strip buffer: its source rows, its output (in each buffer of the PNG encoder ring)
+// and, for ANSI, the band copy; cell files hold glyphs, colors and the plain text they are indexed from
+static size_t stripBytesPerTextRow(const Options& options, const Converter& converter, int sourceRows, int width,
+                                   int channels, int sourceWidth, bool cells) {
+    size_t source = (size_t)sourceRows * width * channels;
+    int cols = sourceWidth / options.widthScale;
+    if (cells) {
+        return source + (size_t)cols * 4 + cols + 1;
+    }
+    switch (options.mode) {
+        case MODE_COLOR_IMAGE: return source + (size_t)STRIP_ENCODER_BUFFERS * options.heightScale * cols * options.widthScale * 3;
+        case MODE_TEXT:        return source + (size_t)cols + 1;
+        default:               return source + 2 * converter.maxTextSize(sourceWidth, options.heightScale);
+    }
+}
+
+// Strips of text rows: decode the source rows of the strip, convert them, flush them, reuse the buffers
+// Only one strip is ever in memory, its height is the largest that fits options.maxMemory
+Status streamFile(const char* inputPath, const char* outputPath, const Options& options) {
+    if (options.widthScale < 1 || options.heightScale < 1) {
+        return ERROR_ARGUMENT;
+    }
+    if (options.mode == MODE_TEXT && options.match == MATCH_BRIGHTNESS && options.dither != DITHER_NONE) {
+        return ERROR_ARGUMENT;  // Every strip would restart the error diffusion and the Bayer row phase
+    }
+    Stats* stats = options.stats;
+    long long images = stats != NULL ? stats->images : 0;
+    double start = stageStart(stats);
+    StripReader reader;
+    if (stripReaderOpen(&reader, inputPath, decodesGray(options),
+                        decodeReductionForOptions(options)) != 0) {
+        FILE* file = fopen(inputPath, "rb");
+        if (file == NULL) {
+            return ERROR_LOAD;
+        }
+        fclose(file);
+        return ERROR_MEMORY;  // Readable, but not a format that can be decoded in strips
+    }
+    stageEnd(stats, STAGE_DECODE, start);
+
+    Converter converter(options);
+    int cols, rows;
+    Status status = converter.gridSize(reader.sourceWidth, reader.sourceHeight, &cols, &rows);
+    if (status != OK) {
+        stripReaderClose(&reader);
+        return status;
+    }
+
+    // Source rows of every text row (in decoded rows, so reduced JPEGs need fewer)
+    std::vector<int> yBounds;
+    cellBounds(rows, options.heightScale, reader.height, reader.sourceHeight, yBounds);
+    int cellRows = 1;
+    for (int i = 0; i < rows; i++) {
+        if (yBounds[i + 1] - yBounds[i] > cellRows) cellRows = yBounds[i + 1] - yBounds[i];
+    }
+    bool cells = isCellsPath(outputPath);
+    if (cells && (options.mode == MODE_HALF_BLOCK || options.mode == MODE_BRAILLE)) {
+        stripReaderClose(&reader);
+        return ERROR_ARGUMENT;  // Checked before the cell file is created (see Converter::convertCells())
+    }
+    size_t perTextRow = stripBytesPerTextRow(options, converter, cellRows, reader.width, reader.channels, reader.sourceWidth, cells);
+    size_t fit = options.maxMemory / perTextRow;
+    if (fit < 1) {
+        stripReaderClose(&reader);
+        return ERROR_MEMORY;
+    }
+    int stripRows = fit < (size_t)rows ? (int)fit : rows;
+
+    // Strip buffers, sized once
+    size_t stride = (size_t)reader.width * reader.channels;
+    std::vector<unsigned char> source((size_t)stripRows * cellRows * stride);
+    std::vector<char> text;
+    std::vector<unsigned char> glyphs, colors;
+    int fd = -1;
+    StripEncoder png;  // Compresses a strip while the next one is decoded and rendered
+    CellWriter cellWriter;
+    bool color = options.mode != MODE_TEXT;  // Cell files keep colors in every colored mode
+    if (cells) {
+        glyphs.resize((size_t)stripRows * cols);
+        colors.resize(color ? (size_t)stripRows * cols * 3 : 0);
+        if (cellWriterOpen(&cellWriter, outputPath, cols, rows, options.widthScale, options.heightScale,
+                           options.asciiChars.c_str(), color) != 0) {
+            stripReaderClose(&reader);
+            return ERROR_OUTPUT;
+        }
+    } else if (options.mode == MODE_COLOR_IMAGE) {
+        if (png.open(outputPath, cols * options.widthScale, rows * options.heightScale, stripRows * options.heightScale) != 0) {
+            stripReaderClose(&reader);
+            return ERROR_OUTPUT;
+        }
+    } else {
+        text.resize(converter.maxTextSize(reader.sourceWidth, stripRows * options.heightScale));
+        fd = openOutput(outputPath);
+        if (fd < 0) {
+            stripReaderClose(&reader);
+            return ERROR_OUTPUT;
+        }
+    }
+
+    for (int first = 0; first < rows && status == OK; first += stripRows) {
+        int last = first + stripRows < rows ? first + stripRows : rows;
+        int height = yBounds[last] - yBounds[first];
+
+        start = stageStart(stats);
+        if (stripReaderRead(&reader, source.data(), stride, height) != 0) {
+            status = ERROR_LOAD;
+            break;
+        }
+        stageEnd(stats, STAGE_DECODE, start);
+
+        // The strip stands for (last - first) * heightScale source rows, so it converts to exactly its text rows
+        ImageView view;
+        view.data = source.data();
+        view.width = reader.width;
+        view.height = height;
+        view.stride = stride;
+        view.format = reader.channels == 1 ? FORMAT_GRAY8 : FORMAT_BGR24;
+        view.sourceWidth = reader.sourceWidth;
+        view.sourceHeight = (last - first) * options.heightScale;
+
+        if (cells) {
+            status = converter.convertCells(view, glyphs.data(), cols, color ? colors.data() : NULL, (size_t)cols * 3);
+            if (status != OK) break;
+            start = stageStart(stats);
+            if (cellWriterRows(&cellWriter, glyphs.data(), cols, colors.data(), (size_t)cols * 3, last - first) != 0) {
+                status = ERROR_OUTPUT;
+                break;
+            }
+            stageEnd(stats, STAGE_WRITE, start);
+            continue;
+        }
+        if (options.mode == MODE_COLOR_IMAGE) {
+            int buffer = png.acquire();
+            if (buffer < 0) {
+                status = ERROR_OUTPUT;
+                break;
+            }
+            ImageSpan strip = {png.data(buffer), cols * options.widthScale, (last - first) * options.heightScale, png.stride()};
+            status = converter.renderColor(view, strip);
+            if (status != OK) break;
+            png.submit(buffer, strip.height);
+            continue;
+        }
+
+        Span span = {text.data(), text.size()};
+        size_t written = 0;
+        status = converter.convertText(view, span, &written);
+        if (status != OK) break;
+        start = stageStart(stats);
+        if (writeAll(fd, text.data(), written) != 0 ||
+            (options.echo && !isStdoutPath(outputPath) && writeAll(STDOUT_FILENO, text.data(), written) != 0)) {
+            status = ERROR_OUTPUT;
+            break;
+        }
+        stageEnd(stats, STAGE_WRITE, start);
+        if (stats != NULL) stats->bytesWritten += (long long)written;
+    }
+
+    stripReaderClose(&reader);
+    if (cells) {
+        if (cellWriterClose(&cellWriter) != 0 && status == OK) status = ERROR_OUTPUT;
+        struct stat written;
+        if (stats != NULL && status == OK && stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+    } else if (options.mode == MODE_COLOR_IMAGE) {
+        if (status != OK) {
+            png.abort();
+        } else if (png.finish() != 0) {
+            status = ERROR_OUTPUT;
+        }
+        if (stats != NULL) stats->stageSeconds[STAGE_WRITE] += png.encodeSeconds();  // Overlapped with decode and render
+        struct stat written;
+        if (stats != NULL && status == OK && stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+    } else if (close(fd) != 0 && status == OK) {
+        status = ERROR_OUTPUT;
+    }
+    if (stats != NULL) stats->images = images + (status == OK ? 1 : 0);  // Every strip counted as an image
+    return status;
+}
+
+}  // namespace ascii
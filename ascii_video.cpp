@@ -0,0 +1,226 @@
+#include <opencv2/opencv.hpp>   // For image manipulation and cv::VideoCapture
+#include <signal.h>             // For stopping on Ctrl+C, SIGTERM and SIGHUP and for Ctrl+Z
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <chrono>               // For frame pacing
+#include <thread>               // For sleeping until the next frame
+#include <vector>               // For the frame and escape buffers
+#include "image2ascii.h"        // For the library API
+#include "ascii_convert.h"      // For imageViewOfMat()
+#include "ascii_output.h"       // For writeAll() and the cursor escapes
+#include "ascii_stats.h"        // For stage timers
+
+#define VIDEO_DEFAULT_FPS 30.0  // Used when the source does not report its frame rate
+#define VIDEO_MERGE_GAP   8     // Unchanged cells shorter than a cursor escape are rewritten instead of skipped
+#define VIDEO_SIGNALS     5     // Signals the playback handles (see playVideo())
+
+namespace ascii {
+
+static volatile sig_atomic_t videoStopRequested = 0;
+static volatile sig_atomic_t videoSuspendRequested = 0;
+static volatile sig_atomic_t videoContinued = 0;
+
+// Ctrl+C, SIGTERM and SIGHUP stop the playback so the terminal can be restored
+static void videoStopHandler(int) {
+    videoStopRequested = 1;
+}
+
+// Ctrl+Z: the main loop gives the cursor back before it stops
+static void videoSuspendHandler(int) {
+    videoSuspendRequested = 1;
+}
+
+// SIGCONT: the main loop clears the screen and draws the whole frame
+static void videoContinueHandler(int) {
+    videoContinued = 1;
+}
+
+// Moves below the frame (rows text rows and the stats line) and shows the cursor again
+static void videoLeaveTerminal(int rows) {
+    std::vector<char> out;
+    appendCursorTo(out, rows > 0 ? rows + 1 : 0, 0);
+    appendBytes(out, "\033[?25h\n", 7);
+    writeAll(STDOUT_FILENO, out.data(), out.size());
+}
+
+// Appends the escapes that turn the previous frame into the current one (frames of rows x (cols + 1) bytes)
+// Only runs of changed cells are emitted, short unchanged gaps inside a run are rewritten to save a cursor move
+// With prev NULL the whole frame is drawn
+static void appendFrameDelta(std::vector<char>& out, const char* prev, const char* cur, int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        const char* curRow = cur + (size_t)i * (cols + 1);
+        if (prev == NULL) {
+            appendCursorTo(out, i, 0);
+            appendBytes(out, curRow, (size_t)cols);
+            continue;
+        }
+
+        const char* prevRow = prev + (size_t)i * (cols + 1);
+        int j = 0;
+        while (j < cols) {
+            if (curRow[j] == prevRow[j]) {
+                j++;
+                continue;
+            }
+
+            // Changed run: extend while the next change is closer than VIDEO_MERGE_GAP
+            int first = j;
+            int last = j + 1;
+            for (int k = last; k < cols && k - last < VIDEO_MERGE_GAP; k++) {
+                if (curRow[k] != prevRow[k]) last = k + 1;
+            }
+            appendCursorTo(out, i, first);
+            appendBytes(out, curRow + first, (size_t)(last - first));
+            j = last;
+        }
+    }
+}
+
+// Frames are converted exactly like still images and only the cells that changed are redrawn
+// When conversion falls behind, late frames of a file are skipped (live cameras drop by themselves)
+Status playVideo(const char* source, const Options& options, const char* statsFormat) {
+    if (options.mode != MODE_TEXT) {
+        return ERROR_ARGUMENT;  // Frames are diffed cell by cell as one byte per cell
+    }
+    bool cameraIndex = source[0] != '\0' && strspn(source, "0123456789") == strlen(source);
+    bool live = cameraIndex || strncmp(source, "/dev/video", 10) == 0;
+    cv::VideoCapture capture;
+    if (cameraIndex) {
+        capture.open(atoi(source));  // Camera index
+    } else {
+        capture.open(std::string(source));
+    }
+    if (!capture.isOpened()) {
+        return ERROR_LOAD;
+    }
+
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    if (!(fps > 0.0 && fps < 1000.0)) fps = VIDEO_DEFAULT_FPS;
+    std::chrono::steady_clock::duration period =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+
+    Converter converter(options);
+
+    videoStopRequested = 0;
+    videoSuspendRequested = 0;
+    videoContinued = 0;
+    const int signals[VIDEO_SIGNALS] = {SIGINT, SIGTERM, SIGHUP, SIGTSTP, SIGCONT};
+    void (*handlers[VIDEO_SIGNALS])(int) = {videoStopHandler, videoStopHandler, videoStopHandler, videoSuspendHandler,
+                                            videoContinueHandler};
+    struct sigaction actions[VIDEO_SIGNALS], previous[VIDEO_SIGNALS];
+    for (int k = 0; k < VIDEO_SIGNALS; k++) {
+        memset(&actions[k], 0, sizeof(actions[k]));
+        sigemptyset(&actions[k].sa_mask);
+        actions[k].sa_handler = handlers[k];
+        sigaction(signals[k], &actions[k], &previous[k]);
+    }
+
+    std::vector<char> frames[2];  // Current and previous frame, swapped every frame
+    int rows = 0, cols = 0;
+    int current = 0;
+    std::vector<char> out;
+    appendBytes(out, "\033[?25l\033[2J", 10);  // Hide cursor, clear screen
+
+    cv::Mat frame;
+    Status status = OK;
+    long long frameIndex = 0;
+    int dropped = 0;
+    int shownInWindow = 0;
+    double achievedFps = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point windowStart = start;
+
+    Stats* playbackStats = options.stats;
+    double decodeStart = stageStart(playbackStats);
+    while (!videoStopRequested && capture.read(frame)) {
+        stageEnd(playbackStats, STAGE_DECODE, decodeStart);
+        if (videoSuspendRequested) {
+            // Ctrl+Z: the shell gets its cursor back below the frame, then the default action stops the process
+            videoSuspendRequested = 0;
+            videoLeaveTerminal(rows);
+            signal(SIGTSTP, SIG_DFL);
+            raise(SIGTSTP);  // Returns once the shell continues the job
+            sigaction(SIGTSTP, &actions[3], NULL);
+            videoContinued = 1;  // Also when the stop was discarded (orphaned process group)
+        }
+        if (videoContinued) {
+            // Continued: the shell may have drawn over the frame, so it is cleared and drawn whole on the current size,
+            // and a file resumes from this frame instead of skipping the time it was stopped
+            videoContinued = 0;
+            appendBytes(out, "\033[?25l", 6);
+            rows = 0;
+            cols = 0;
+            start = std::chrono::steady_clock::now() - period * frameIndex;
+            windowStart = std::chrono::steady_clock::now();
+            shownInWindow = 0;
+        }
+        int frameCols, frameRows;
+        status = converter.gridSize(frame.cols, frame.rows, &frameCols, &frameRows);
+        if (status != OK) break;
+
+        // A new size (first frame or camera change) needs new frame buffers and a full redraw
+        bool redraw = frameRows != rows || frameCols != cols;
+        if (redraw) {
+            rows = frameRows;
+            cols = frameCols;
+            frames[0].assign((size_t)rows * (cols + 1), '\0');
+            frames[1].assign((size_t)rows * (cols + 1), '\0');
+            appendBytes(out, "\033[2J", 4);
+        }
+
+        Span text = {frames[current].data(), frames[current].size()};
+        status = converter.convertText(imageViewOfMat(frame), text, NULL);
+        if (status != OK) break;
+        appendFrameDelta(out, redraw ? NULL : frames[1 - current].data(), frames[current].data(), rows, cols);
+        size_t frameBytes = out.size();
+
+        // Stats line under the picture
+        char stats[128];
+        int statsSize = snprintf(stats, sizeof(stats), statsFormat, achievedFps, (int)frameBytes, dropped);
+        appendCursorTo(out, rows, 0);
+        appendBytes(out, "\033[K", 3);
+        appendBytes(out, stats, (size_t)(statsSize < (int)sizeof(stats) ? statsSize : (int)sizeof(stats) - 1));
+
+        double writeStart = stageStart(playbackStats);
+        writeAll(STDOUT_FILENO, out.data(), out.size());  // One write per frame
+        stageEnd(playbackStats, STAGE_WRITE, writeStart);
+        if (playbackStats != NULL) playbackStats->bytesWritten += (long long)out.size();
+        out.clear();
+        current = 1 - current;
+        frameIndex++;
+        shownInWindow++;
+
+        // Achieved fps over windows of about one second
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double windowSeconds = std::chrono::duration<double>(now - windowStart).count();
+        if (windowSeconds >= 1.0) {
+            achievedFps = shownInWindow / windowSeconds;
+            shownInWindow = 0;
+            windowStart = now;
+        }
+
+        // Live sources pace themselves, files wait for the next frame time or skip the frames already late
+        if (!live) {
+            std::chrono::steady_clock::time_point deadline = start + period * frameIndex;
+            if (now < deadline) {
+                std::this_thread::sleep_until(deadline);
+            } else {
+                while (start + period * (frameIndex + 1) <= now && capture.grab()) {
+                    frameIndex++;
+                    dropped++;
+                }
+            }
+        }
+        decodeStart = stageStart(playbackStats);
+    }
+
+    // Restore the terminal below the last frame
+    videoLeaveTerminal(rows);
+    for (int k = VIDEO_SIGNALS - 1; k >= 0; k--) {
+        sigaction(signals[k], &previous[k], NULL);
+    }
+    return status;
+}
+
+}  // namespace ascii
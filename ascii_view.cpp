@@ -0,0 +1,532 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <poll.h>               // For waiting on keys
+#include <signal.h>             // For the resize, stop and suspend signals
+#include <stdint.h>             // For the tile keys
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+#include <sys/ioctl.h>          // For the terminal size
+#include <termios.h>            // For reading keys without Enter
+#include <unistd.h>             // For isatty() / read()
+#include <list>                 // For the least recently used order of the tiles
+#include <memory>               // For tiles shared by the cache and the frame
+#include <unordered_map>        // For the tile cache
+#include <vector>               // For the frame and escape buffers
+#include "image2ascii.h"        // For the library API
+#include "ansi_color.h"         // For the colored rows
+#include "ascii_decode.h"       // For decodeReduced()
+#include "ascii_lut.h"          // For the intensity -> glyph table
+#include "ascii_output.h"       // For writeAll() and the cursor escapes
+#include "ascii_stats.h"        // For stage timers and worker loads
+#include "cell_average.h"       // For the cell box average and the pyramid halvings
+#include "thread_pool.h"        // For the tile-parallel scheduler
+
+#define VIEW_TILE_COLS  32      // Cells per tile, horizontally
+#define VIEW_TILE_ROWS  16      // Cells per tile, vertically
+#define VIEW_TILE_CACHE 4096    // Tiles kept (2 KiB each with colors) before the least recently used are dropped
+#define VIEW_KEY_BYTES  64      // Bytes read per batch of keys (escape sequences included)
+#define VIEW_POLL_MS    250     // Longest wait for a key, so a resize landing just before the wait is not missed
+#define VIEW_ESCAPE_MS  50      // Wait for the rest of an escape sequence before a lone Esc counts as a key
+#define VIEW_SIGNALS    6       // Signals the viewer handles (see viewImage())
+
+namespace ascii {
+
+static volatile sig_atomic_t viewStopRequested = 0;
+static volatile sig_atomic_t viewResized = 0;
+static volatile sig_atomic_t viewSuspendRequested = 0;
+static volatile sig_atomic_t viewContinued = 0;
+
+// Ctrl+C, SIGTERM and SIGHUP stop the viewer so the terminal can be restored
+static void viewStopHandler(int) {
+    viewStopRequested = 1;
+}
+
+// SIGWINCH: the next frame is laid out for the new terminal size
+static void viewResizeHandler(int) {
+    viewResized = 1;
+}
+
+// Ctrl+Z: the main loop gives the terminal back before it stops
+static void viewSuspendHandler(int) {
+    viewSuspendRequested = 1;
+}
+
+// SIGCONT: the main loop takes the terminal again and draws the whole frame
+static void viewContinueHandler(int) {
+    viewContinued = 1;
+}
+
+// Cells of one tile: intensities and, in the colored modes, mean BGR colors (cols x rows, clipped at the grid edge)
+struct ViewTile {
+    int cols;
+    int rows;
+    std::vector<unsigned char> gray;
+    std::vector<unsigned char> bgr;
+};
+
+// Least recently used tiles, keyed by zoom and tile position (viewTileKey())
+// Tiles are shared, so the ones on screen stay alive even if they are dropped from the cache
+class ViewTileCache {
+public:
+    explicit ViewTileCache(size_t capacity) : capacity_(capacity) {}
+
+    std::shared_ptr<ViewTile> find(uint64_t key) {
+        std::unordered_map<uint64_t, Order::iterator>::iterator found = index_.find(key);
+        if (found == index_.end()) {
+            return std::shared_ptr<ViewTile>();
+        }
+        order_.splice(order_.begin(), order_, found->second);  // Most recently used first
+        return found->second->second;
+    }
+
+    void insert(uint64_t key, const std::shared_ptr<ViewTile>& tile) {
+        order_.push_front(std::make_pair(key, tile));
+        index_[key] = order_.begin();
+        while (order_.size() > capacity_) {
+            index_.erase(order_.back().first);
+            order_.pop_back();
+        }
+    }
+
+private:
+    typedef std::list<std::pair<uint64_t, std::shared_ptr<ViewTile> > > Order;
+    Order order_;
+    std::unordered_map<uint64_t, Order::iterator> index_;
+    size_t capacity_;
+};
+
+// Zoom and position: cells of cellWidth x cellHeight source pixels on a grid that starts at the image corner,
+// so the tiles of a zoom are the same wherever the viewport goes
+struct ViewState {
+    int cellWidth;
+    int cellHeight;
+    int gridCols;
+    int gridRows;
+    int originCol;   // Top-left visible cell
+    int originRow;
+    int viewCols;    // Visible cells (the terminal, or the whole grid when it is smaller)
+    int viewRows;
+    int termCols;
+    int termRows;
+};
+
+// Everything the viewer keeps between frames
+struct Viewer {
+    std::vector<cv::Mat> levels;         // Decoded image and its 2x2 box pyramid, level k is 2^k times smaller
+    int width;                           // Size of the decoded image
+    int height;
+    Options options;
+    int threads;
+    bool color;                          // ANSI escapes with the mean color of every cell
+    int ansiMode;
+    unsigned char glyphLUT[GLYPH_LUT_SIZE];
+    std::vector<unsigned char> paletteTable;  // MODE_ANSI_256 only
+    ViewState state;
+    ViewTileCache cache;
+    std::vector<unsigned char> gray;     // Visible cells of the frame on screen
+    std::vector<unsigned char> bgr;
+    int frameCols;                       // Size of the frame on screen, 0 before the first one
+    int frameRows;
+    std::vector<char> out;
+    std::vector<char> keys;              // Keys read but not applied yet (an escape sequence cut by the end of a read)
+    const char* statusFormat;
+
+    Viewer() : width(0), height(0), threads(1), color(false), ansiMode(ANSI_MODE_TRUECOLOR), cache(VIEW_TILE_CACHE),
+               frameCols(0), frameRows(0), statusFormat("") {}
+};
+
+// Tile key: cell width (the cell height follows it), tile row and tile column
+static inline uint64_t viewTileKey(int cellWidth, int tileCol, int tileRow) {
+    return ((uint64_t)cellWidth << 44) | ((uint64_t)tileRow << 22) | (uint64_t)tileCol;
+}
+
+// Cell height of a cell width, with the aspect of the option scales
+static inline int viewCellHeight(int cellWidth, const Options& options) {
+    long long height = ((long long)cellWidth * options.heightScale + options.widthScale / 2) / options.widthScale;
+    return height > 0 ? (int)height : 1;
+}
+
+// Deepest pyramid level that still gives every cell at least one pixel
+static inline int viewLevelFor(const Viewer* viewer, int cellWidth, int cellHeight) {
+    int smaller = cellWidth < cellHeight ? cellWidth : cellHeight;
+    int level = 0;
+    while (level + 1 < (int)viewer->levels.size() && (2 << level) <= smaller) level++;
+    return level;
+}
+
+// Pixel bound of a cell edge on a pyramid level (size pixels wide); cells never fall below one pixel because
+// the level is at most cellSize times smaller and the grid stops at the last cell that starts inside the image
+static inline int viewCellBound(int cell, int cellSize, int level, int size) {
+    long long bound = ((long long)cell * cellSize) >> level;
+    return bound < size ? (int)bound : size;
+}
+
+// Converts one tile of the current zoom: each cell averages the pixels it covers on the deepest pyramid level that
+// still gives it one, so a tile costs about the same at any zoom and on any source size
+static void viewConvertTile(const Viewer* viewer, int tileCol, int tileRow, ViewTile* tile) {
+    const ViewState& state = viewer->state;
+    int level = viewLevelFor(viewer, state.cellWidth, state.cellHeight);
+    const cv::Mat& src = viewer->levels[level];
+    int firstCol = tileCol * VIEW_TILE_COLS, firstRow = tileRow * VIEW_TILE_ROWS;
+    tile->cols = state.gridCols - firstCol < VIEW_TILE_COLS ? state.gridCols - firstCol : VIEW_TILE_COLS;
+    tile->rows = state.gridRows - firstRow < VIEW_TILE_ROWS ? state.gridRows - firstRow : VIEW_TILE_ROWS;
+
+    std::vector<int> xBounds(tile->cols + 1), yBounds(tile->rows + 1);
+    for (int k = 0; k <= tile->cols; k++) xBounds[k] = viewCellBound(firstCol + k, state.cellWidth, level, src.cols);
+    for (int k = 0; k <= tile->rows; k++) yBounds[k] = viewCellBound(firstRow + k, state.cellHeight, level, src.rows);
+
+    std::vector<unsigned long long> sums((size_t)tile->cols * 3);
+    tile->gray.resize((size_t)tile->cols * tile->rows);
+    if (viewer->color) tile->bgr.resize((size_t)tile->cols * tile->rows * 3);
+    for (int i = 0; i < tile->rows; i++) {
+        averageCellRow(src, xBounds.data(), yBounds.data(), i, tile->cols, false, sums.data(),
+                       viewer->color ? &tile->bgr[(size_t)i * tile->cols * 3] : NULL, &tile->gray[(size_t)i * tile->cols]);
+    }
+}
+
+// Terminal size in characters (80 x 24 if it cannot be read)
+static void viewTerminalSize(int* cols, int* rows) {
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 && size.ws_row > 0) {
+        *cols = size.ws_col;
+        *rows = size.ws_row;
+    } else {
+        *cols = 80;
+        *rows = 24;
+    }
+}
+
+// Rows left for the picture, the last terminal row holds the status line
+static inline int viewPictureRows(const ViewState& state) {
+    return state.termRows > 1 ? state.termRows - 1 : 1;
+}
+
+// Smallest cell width that shows the whole image on the terminal (the widest zoom out)
+static int viewFitCellWidth(const Viewer* viewer) {
+    const ViewState& state = viewer->state;
+    int rows = viewPictureRows(state);
+    int cellWidth = (viewer->width + state.termCols - 1) / state.termCols;
+    if (cellWidth < 1) cellWidth = 1;
+    while ((viewer->height + viewCellHeight(cellWidth, viewer->options) - 1) / viewCellHeight(cellWidth, viewer->options) > rows) {
+        cellWidth++;
+    }
+    return cellWidth;
+}
+
+// Keeps the viewport inside the grid
+static void viewClamp(ViewState* state) {
+    if (state->originCol > state->gridCols - state->viewCols) state->originCol = state->gridCols - state->viewCols;
+    if (state->originRow > state->gridRows - state->viewRows) state->originRow = state->gridRows - state->viewRows;
+    if (state->originCol < 0) state->originCol = 0;
+    if (state->originRow < 0) state->originRow = 0;
+}
+
+// Lays the grid of cellWidth out on the terminal with the source point (centerX, centerY) in the middle
+static void viewLayout(Viewer* viewer, int cellWidth, double centerX, double centerY) {
+    ViewState& state = viewer->state;
+    state.cellWidth = cellWidth;
+    state.cellHeight = viewCellHeight(cellWidth, viewer->options);
+    state.gridCols = (viewer->width + state.cellWidth - 1) / state.cellWidth;
+    state.gridRows = (viewer->height + state.cellHeight - 1) / state.cellHeight;
+    state.viewCols = state.termCols < state.gridCols ? state.termCols : state.gridCols;
+    state.viewRows = viewPictureRows(state) < state.gridRows ? viewPictureRows(state) : state.gridRows;
+    state.originCol = (int)(centerX / state.cellWidth - state.viewCols / 2.0);
+    state.originRow = (int)(centerY / state.cellHeight - state.viewRows / 2.0);
+    viewClamp(&state);
+}
+
+// Source point at the middle of the viewport
+static void viewCenter(const ViewState& state, double* centerX, double* centerY) {
+    *centerX = (state.originCol + state.viewCols / 2.0) * state.cellWidth;
+    *centerY = (state.originRow + state.viewRows / 2.0) * state.cellHeight;
+}
+
+// Draws the viewport: tiles missing from the cache are converted in parallel, the others are reused, and only the
+// rows that differ from the frame on screen are rewritten (all of them when the viewport changed size)
+static void viewRender(Viewer* viewer) {
+    double start = monotonicSeconds();
+    Stats* stats = viewer->options.stats;
+    const ViewState& state = viewer->state;
+    int firstTileCol = state.originCol / VIEW_TILE_COLS, lastTileCol = (state.originCol + state.viewCols - 1) / VIEW_TILE_COLS;
+    int firstTileRow = state.originRow / VIEW_TILE_ROWS, lastTileRow = (state.originRow + state.viewRows - 1) / VIEW_TILE_ROWS;
+    int tilesAcross = lastTileCol - firstTileCol + 1;
+    int tileCount = tilesAcross * (lastTileRow - firstTileRow + 1);
+
+    std::vector<std::shared_ptr<ViewTile> > visible(tileCount);
+    std::vector<int> missing;
+    for (int t = 0; t < tileCount; t++) {
+        visible[t] = viewer->cache.find(viewTileKey(state.cellWidth, firstTileCol + t % tilesAcross, firstTileRow + t / tilesAcross));
+        if (!visible[t]) {
+            visible[t] = std::make_shared<ViewTile>();
+            missing.push_back(t);
+        }
+    }
+
+    // Newly visible tiles only, one band each
+    double convertStart = stageStart(stats);
+    std::vector<WorkerLoad> loads;
+    parallelForBands((int)missing.size(), viewer->threads, [&](int k) {
+        int t = missing[k];
+        viewConvertTile(viewer, firstTileCol + t % tilesAcross, firstTileRow + t / tilesAcross, visible[t].get());
+    }, workerLoadsFor(stats, loads));
+    stageEnd(stats, STAGE_CONVERT, convertStart);
+    addWorkerLoads(stats, loads);
+    for (size_t k = 0; k < missing.size(); k++) {
+        int t = missing[k];
+        viewer->cache.insert(viewTileKey(state.cellWidth, firstTileCol + t % tilesAcross, firstTileRow + t / tilesAcross), visible[t]);
+        if (stats != NULL) stats->cells += (long long)visible[t]->cols * visible[t]->rows;
+    }
+
+    // Visible cells of the tiles, compared row by row with the frame on screen
+    bool redraw = state.viewCols != viewer->frameCols || state.viewRows != viewer->frameRows;
+    std::vector<unsigned char> gray((size_t)state.viewCols * state.viewRows);
+    std::vector<unsigned char> bgr(viewer->color ? gray.size() * 3 : 0);
+    for (int i = 0; i < state.viewRows; i++) {
+        int gridRow = state.originRow + i;
+        int tileRow = gridRow / VIEW_TILE_ROWS - firstTileRow;
+        for (int j = 0; j < state.viewCols;) {
+            int gridCol = state.originCol + j;
+            const ViewTile* tile = visible[tileRow * tilesAcross + gridCol / VIEW_TILE_COLS - firstTileCol].get();
+            int x = gridCol % VIEW_TILE_COLS, y = gridRow % VIEW_TILE_ROWS;
+            int n = tile->cols - x < state.viewCols - j ? tile->cols - x : state.viewCols - j;
+            size_t cell = (size_t)y * tile->cols + x;
+            memcpy(&gray[(size_t)i * state.viewCols + j], &tile->gray[cell], (size_t)n);
+            if (viewer->color) memcpy(&bgr[((size_t)i * state.viewCols + j) * 3], &tile->bgr[cell * 3], (size_t)n * 3);
+            j += n;
+        }
+    }
+
+    std::vector<char>& out = viewer->out;
+    out.clear();
+    if (redraw) appendBytes(out, "\033[2J", 4);
+    std::vector<char> line((size_t)state.viewCols * ANSI_MAX_CELL_BYTES + 5);
+    for (int i = 0; i < state.viewRows; i++) {
+        const unsigned char* grayRow = &gray[(size_t)i * state.viewCols];
+        const unsigned char* bgrRow = viewer->color ? &bgr[(size_t)i * state.viewCols * 3] : NULL;
+        if (!redraw && memcmp(grayRow, &viewer->gray[(size_t)i * state.viewCols], (size_t)state.viewCols) == 0 &&
+            (bgrRow == NULL || memcmp(bgrRow, &viewer->bgr[(size_t)i * state.viewCols * 3], (size_t)state.viewCols * 3) == 0)) {
+            continue;  // Row already on screen
+        }
+        size_t size;
+        if (viewer->color) {
+            // The breakline of the row is dropped, rows are placed with the cursor
+            size = ansiRowToText(grayRow, (const cv::Vec3b*)bgrRow, state.viewCols, viewer->glyphLUT, viewer->paletteTable.data(),
+                                 viewer->ansiMode, line.data()) - 1;
+        } else {
+            mapRowToASCII(grayRow, line.data(), state.viewCols, viewer->glyphLUT);
+            size = (size_t)state.viewCols;
+        }
+        appendCursorTo(out, i, 0);
+        appendBytes(out, line.data(), size);
+    }
+    viewer->gray.swap(gray);
+    viewer->bgr.swap(bgr);
+    viewer->frameCols = state.viewCols;
+    viewer->frameRows = state.viewRows;
+
+    // Status line on the last terminal row, cut to its width
+    char status[256];
+    int statusSize = snprintf(status, sizeof(status), viewer->statusFormat, state.originCol * state.cellWidth,
+                              state.originRow * state.cellHeight, state.cellWidth, state.cellHeight,
+                              viewLevelFor(viewer, state.cellWidth, state.cellHeight), (int)missing.size(),
+                              tileCount - (int)missing.size(), (monotonicSeconds() - start) * 1000.0);
+    if (statusSize < 0) statusSize = 0;
+    if (statusSize >= (int)sizeof(status)) statusSize = (int)sizeof(status) - 1;
+    if (statusSize > state.termCols) statusSize = state.termCols;
+    appendCursorTo(out, state.termRows - 1, 0);
+    appendBytes(out, "\033[K", 3);
+    appendBytes(out, status, (size_t)statusSize);
+
+    double writeStart = stageStart(stats);
+    writeAll(STDOUT_FILENO, out.data(), out.size());  // One write per frame
+    stageEnd(stats, STAGE_WRITE, writeStart);
+    if (stats != NULL) stats->bytesWritten += (long long)out.size();
+}
+
+// Applies the keys read so far (viewer->keys), returns true if the viewport changed
+// Arrows or h/j/k/l pan by an eighth of the screen, + and - zoom around the middle, 0 fits the image, q or Esc quits
+// An escape sequence cut by the end of a read waits for the next one; flush applies it as typed, so a lone Esc quits
+static bool viewHandleKeys(Viewer* viewer, bool flush) {
+    ViewState& state = viewer->state;
+    const std::vector<char>& keys = viewer->keys;
+    int count = (int)keys.size();
+    bool changed = false;
+    int k = 0;
+    for (; k < count; k++) {
+        int panCols = 0, panRows = 0, cellWidth = state.cellWidth;
+        char key = keys[k];
+        if (key == '\033') {
+            bool introducer = k + 1 < count && (keys[k + 1] == '[' || keys[k + 1] == 'O');  // CSI or SS3 (application mode)
+            if (!flush && (k + 1 == count || (introducer && k + 2 == count))) break;  // The rest is still on its way
+            if (introducer && k + 2 < count) {
+                char code = keys[k + 2];
+                key = code == 'A' ? 'k' : code == 'B' ? 'j' : code == 'C' ? 'l' : code == 'D' ? 'h' : '\0';
+                k += 2;
+            }
+        }
+        switch (key) {
+            case 'q': case 'Q': case '\033': viewStopRequested = 1; viewer->keys.clear(); return changed;
+            case 'h': panCols = -1; break;
+            case 'l': panCols = 1; break;
+            case 'k': panRows = -1; break;
+            case 'j': panRows = 1; break;
+            case '+': case '=': cellWidth = state.cellWidth > 1 ? state.cellWidth / 2 : 1; break;
+            case '-': case '_': cellWidth = state.cellWidth * 2; break;
+            case '0': cellWidth = viewFitCellWidth(viewer); break;
+            default: continue;
+        }
+        int fit = viewFitCellWidth(viewer);
+        if (cellWidth > fit) cellWidth = fit;  // Zooming out stops once the whole image shows
+        if (cellWidth != state.cellWidth) {
+            double centerX, centerY;
+            viewCenter(state, &centerX, &centerY);
+            viewLayout(viewer, cellWidth, centerX, centerY);
+            changed = true;
+        } else if (panCols != 0 || panRows != 0) {
+            int originCol = state.originCol, originRow = state.originRow;
+            state.originCol += panCols * (state.viewCols / 8 > 1 ? state.viewCols / 8 : 1);
+            state.originRow += panRows * (state.viewRows / 8 > 1 ? state.viewRows / 8 : 1);
+            viewClamp(&state);
+            changed = changed || state.originCol != originCol || state.originRow != originRow;
+        }
+    }
+    viewer->keys.erase(viewer->keys.begin(), viewer->keys.begin() + k);
+    return changed;
+}
+
+// Raw keys (no Enter, no echo), alternate screen and hidden cursor
+static void viewEnterTerminal(const struct termios* rawTerminal) {
+    tcsetattr(STDIN_FILENO, TCSANOW, rawTerminal);
+    const char* enter = "\033[?1049h\033[?25l";
+    writeAll(STDOUT_FILENO, enter, strlen(enter));
+}
+
+// Shows the cursor, goes back to the main screen and restores the terminal settings
+static void viewLeaveTerminal(const struct termios* savedTerminal) {
+    const char* leave = "\033[?25h\033[?1049l";
+    writeAll(STDOUT_FILENO, leave, strlen(leave));
+    tcsetattr(STDIN_FILENO, TCSANOW, savedTerminal);
+}
+
+// The image is decoded once at full size and halved into a pyramid; a frame only converts the tiles it has not
+// converted at that zoom before, from the pyramid level matching the zoom, so panning, zooming and resizing cost
+// the newly visible cells, not the source size
+Status viewImage(const char* inputPath, const Options& options, const char* statusFormat) {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO) || options.widthScale < 1 || options.heightScale < 1) {
+        return ERROR_ARGUMENT;
+    }
+    Viewer viewer;
+    viewer.options = options;
+    viewer.threads = options.threads > 0 ? options.threads : defaultThreadCount();
+    viewer.color = options.mode != MODE_TEXT && options.mode != MODE_BRAILLE;
+    viewer.ansiMode = options.mode == MODE_ANSI_256 ? ANSI_MODE_256 : ANSI_MODE_TRUECOLOR;
+    viewer.statusFormat = statusFormat;
+    buildGlyphLUT(options.asciiChars.c_str(), viewer.glyphLUT);
+    if (viewer.ansiMode == ANSI_MODE_256) {
+        viewer.paletteTable.resize(ANSI_PALETTE_SIZE);
+        buildAnsi256Table(viewer.paletteTable.data());
+    }
+
+    // Every zoom down to one pixel per cell is reachable, so the image is decoded at full size
+    Stats* stats = options.stats;
+    double decodeStart = stageStart(stats);
+    int reduction = 1;
+    cv::Mat image = decodeReduced(inputPath, &reduction, !viewer.color, &viewer.width, &viewer.height);
+    stageEnd(stats, STAGE_DECODE, decodeStart);
+    if (image.empty()) {
+        return ERROR_LOAD;
+    }
+    if (stats != NULL) stats->images++;
+
+    double resizeStart = stageStart(stats);
+    std::vector<WorkerLoad> loads;
+    viewer.levels.push_back(image);
+    while (viewer.levels.back().cols > 1 && viewer.levels.back().rows > 1) {
+        cv::Mat half;
+        halveImage(viewer.levels.back(), half, viewer.threads, workerLoadsFor(stats, loads));
+        viewer.levels.push_back(half);
+    }
+    stageEnd(stats, STAGE_RESIZE, resizeStart);
+    addWorkerLoads(stats, loads);
+
+    // Keys without Enter or echo; every handled signal interrupts the wait for a key (no SA_RESTART)
+    struct termios savedTerminal, rawTerminal;
+    tcgetattr(STDIN_FILENO, &savedTerminal);
+    rawTerminal = savedTerminal;
+    rawTerminal.c_lflag &= ~(ICANON | ECHO);
+    rawTerminal.c_cc[VMIN] = 1;
+    rawTerminal.c_cc[VTIME] = 0;
+    viewStopRequested = 0;
+    viewResized = 0;
+    viewSuspendRequested = 0;
+    viewContinued = 0;
+    const int signals[VIEW_SIGNALS] = {SIGINT, SIGTERM, SIGHUP, SIGWINCH, SIGTSTP, SIGCONT};
+    void (*handlers[VIEW_SIGNALS])(int) = {viewStopHandler, viewStopHandler, viewStopHandler, viewResizeHandler,
+                                           viewSuspendHandler, viewContinueHandler};
+    struct sigaction actions[VIEW_SIGNALS], previous[VIEW_SIGNALS];
+    for (int k = 0; k < VIEW_SIGNALS; k++) {
+        memset(&actions[k], 0, sizeof(actions[k]));
+        sigemptyset(&actions[k].sa_mask);
+        actions[k].sa_handler = handlers[k];
+        sigaction(signals[k], &actions[k], &previous[k]);
+    }
+
+    viewEnterTerminal(&rawTerminal);
+    viewTerminalSize(&viewer.state.termCols, &viewer.state.termRows);
+    viewLayout(&viewer, viewFitCellWidth(&viewer), viewer.width / 2.0, viewer.height / 2.0);
+
+    bool dirty = true;
+    while (!viewStopRequested) {
+        if (viewSuspendRequested) {
+            // Ctrl+Z: the shell gets its own screen and settings back, then the default action stops the process
+            viewSuspendRequested = 0;
+            viewLeaveTerminal(&savedTerminal);
+            signal(SIGTSTP, SIG_DFL);
+            raise(SIGTSTP);  // Returns once the shell continues the job
+            sigaction(SIGTSTP, &actions[4], NULL);
+            viewContinued = 1;  // Also when the stop was discarded (orphaned process group)
+        }
+        if (viewContinued) {
+            // Continued (after Ctrl+Z or any other stop): raw keys and the alternate screen again, then a full frame
+            viewContinued = 0;
+            viewEnterTerminal(&rawTerminal);
+            viewResized = 1;  // The terminal may have been resized while stopped
+        }
+        if (viewResized) {
+            // Same middle and zoom on the new size (tiles of the zoom stay cached), zoomed in if the image now fits wider
+            viewResized = 0;
+            double centerX, centerY;
+            viewCenter(viewer.state, &centerX, &centerY);
+            viewTerminalSize(&viewer.state.termCols, &viewer.state.termRows);
+            int fit = viewFitCellWidth(&viewer);
+            viewLayout(&viewer, viewer.state.cellWidth < fit ? viewer.state.cellWidth : fit, centerX, centerY);
+            viewer.frameCols = 0;  // The terminal reflowed the old frame, draw everything again
+            dirty = true;
+        }
+        if (dirty) {
+            viewRender(&viewer);
+            dirty = false;
+        }
+        struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+        int ready = poll(&input, 1, viewer.keys.empty() ? VIEW_POLL_MS : VIEW_ESCAPE_MS);
+        if (ready == 0 && !viewer.keys.empty() && viewHandleKeys(&viewer, true)) {
+            dirty = true;  // Nothing followed the pending escape, its bytes are keys of their own
+        }
+        if (ready <= 0) {
+            continue;  // Timeout or a signal
+        }
+        char keys[VIEW_KEY_BYTES];
+        ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+        if (count == 0) break;  // The terminal went away
+        if (count < 0) continue;
+        viewer.keys.insert(viewer.keys.end(), keys, keys + count);
+        if (viewHandleKeys(&viewer, false)) dirty = true;
+    }
+
+    viewLeaveTerminal(&savedTerminal);
+    for (int k = VIEW_SIGNALS - 1; k >= 0; k--) {
+        sigaction(signals[k], &previous[k], NULL);
+    }
+    return OK;
+}
+
+}  // namespace ascii
@@ -0,0 +1,227 @@
+#ifndef CELL_AVERAGE_H
+#define CELL_AVERAGE_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <string.h>             // For string manipulation
+#include <vector>               // For the cell bounds and row sums
+#include "ascii_lut.h"          // For intensity -> glyph tables and row kernels
+#include "dither.h"             // For the ordered dither offsets
+#include "thread_pool.h"        // For the tile-parallel band scheduler
+
+#define SUBCELL_COLUMN_BLOCK 512  // Source columns summed at once by averageSubcellRow() (12 KiB of sums)
+#define SUBCELL_NARROW_WIDTH 32   // Subcells narrower than this are averaged with a precomputed reciprocal
+
+// Pixel bounds of the cells along one axis: cell k covers pixels [bounds[k], bounds[k + 1])
+// size pixels of the view stand for sourceSize pixels of the source (less with decode-time reduction)
+// Cells stay at least one pixel wide because scale source pixels never map to less than one view pixel
+static inline void cellBounds(int cells, int scale, int size, int sourceSize, std::vector<int>& bounds) {
+    bounds.resize(cells + 1);
+    for (int k = 0; k <= cells; k++) {
+        long long bound = (long long)k * scale * size / sourceSize;
+        bounds[k] = (int)(bound < size ? bound : size);
+    }
+}
+
+// Subcell bounds of every cell along one axis: part c of cell k covers [bounds[2 * (k * parts + c)], ... + 1)
+// Cells narrower than parts repeat pixels, so every subcell has at least one
+static inline void subcellBounds(const std::vector<int>& cellBounds, int parts, std::vector<int>& bounds) {
+    int cells = (int)cellBounds.size() - 1;
+    bounds.resize((size_t)cells * parts * 2);
+    for (int k = 0; k < cells; k++) {
+        int start = cellBounds[k], size = cellBounds[k + 1] - cellBounds[k];
+        for (int c = 0; c < parts; c++) {
+            int a = start + c * size / parts;
+            int b = start + (c + 1) * size / parts;
+            bounds[2 * (k * parts + c)] = a;
+            bounds[2 * (k * parts + c) + 1] = b > a ? b : a + 1;
+        }
+    }
+}
+
+// Scratch entries averageSubcellRow() needs for src (channel sums of every source column)
+static inline size_t subcellScratchSize(const cv::Mat& src) {
+    return (size_t)src.cols * 3;
+}
+
+// Adds source rows [y0, y1) into the channel sums of columns [x0, x1) (columns holds 3 sums per column, alpha skipped)
+// 1 and 3 channel rows are summed as flat byte runs, so the loop vectorizes
+// Sums are 64-bit: a subcell may be taller than the 2^24 rows of 255 that fit 32 bits
+template <int CHANNELS>
+static inline void sumSubcellColumns(const cv::Mat& src, int x0, int x1, int y0, int y1, unsigned long long* columns) {
+    int stride = CHANNELS == 4 ? 3 : CHANNELS;
+    memset(columns + (size_t)x0 * stride, 0, (size_t)(x1 - x0) * stride * sizeof(unsigned long long));
+    // Blocks of SUBCELL_COLUMN_BLOCK columns, so the sums stay in L1 while every row of the block is added
+    for (int block = x0; block < x1; block += SUBCELL_COLUMN_BLOCK) {
+        int end = block + SUBCELL_COLUMN_BLOCK < x1 ? block + SUBCELL_COLUMN_BLOCK : x1;
+        for (int y = y0; y < y1; y++) {
+            const unsigned char* p = src.ptr<uchar>(y);
+            if (CHANNELS == 4) {
+                for (int x = block; x < end; x++) {
+                    columns[3 * x] += p[4 * x];
+                    columns[3 * x + 1] += p[4 * x + 1];
+                    columns[3 * x + 2] += p[4 * x + 2];
+                }
+            } else {
+                for (int k = block * CHANNELS; k < end * CHANNELS; k++) columns[k] += p[k];
+            }
+        }
+    }
+}
+
+// Mean luma of n subcell columns over source rows [y0, y1) into dst (columns is scratch, subcellScratchSize() entries)
+// The luma weights apply to the channel sums of the subcell, so it is the luma of its mean color (swapRB reads RGB(A))
+// Subcells share the column sums, so narrow subcells cost a few additions instead of a pass over their pixels,
+// and the reciprocal of every narrow width is taken once per call, so they cost a multiply instead of a divide
+static inline void averageSubcellRow(const cv::Mat& src, const int* xSub, int n, int y0, int y1, bool swapRB,
+                                     unsigned long long* columns, unsigned char* dst) {
+    int x0 = xSub[0], x1 = xSub[2 * n - 1];  // Subcells are in order, the last one ends furthest
+    switch (src.channels()) {
+        case 1:  sumSubcellColumns<1>(src, x0, x1, y0, y1, columns); break;
+        case 3:  sumSubcellColumns<3>(src, x0, x1, y0, y1, columns); break;
+        default: sumSubcellColumns<4>(src, x0, x1, y0, y1, columns); break;
+    }
+    // Mean of a sum over width columns: sum * scale[width] (luma sums carry the LUMA_SHIFT of the weights)
+    double rowScale = 1.0 / ((double)(y1 - y0) * (src.channels() == 1 ? 1.0 : (double)(1 << LUMA_SHIFT)));
+    double scale[SUBCELL_NARROW_WIDTH];
+    for (int w = 1; w < SUBCELL_NARROW_WIDTH; w++) scale[w] = rowScale / w;
+    for (int k = 0; k < n; k++) {
+        int first = xSub[2 * k], end = xSub[2 * k + 1];
+        if (k > 0 && first == xSub[2 * k - 2] && end == xSub[2 * k - 1]) {
+            dst[k] = dst[k - 1];  // Cells narrower than their subcells repeat pixels
+            continue;
+        }
+        double widthScale = end - first < SUBCELL_NARROW_WIDTH ? scale[end - first] : rowScale / (end - first);
+        if (src.channels() == 1) {
+            unsigned long long sum = 0;
+            for (int x = first; x < end; x++) sum += columns[x];
+            dst[k] = (unsigned char)((double)(long long)sum * widthScale + 0.5);
+            continue;
+        }
+        unsigned long long s0 = 0, s1 = 0, s2 = 0;
+        for (int x = first; x < end; x++) {
+            s0 += columns[3 * x];
+            s1 += columns[3 * x + 1];
+            s2 += columns[3 * x + 2];
+        }
+        unsigned long long luma = swapRB ? s2 * LUMA_WEIGHT_B + s1 * LUMA_WEIGHT_G + s0 * LUMA_WEIGHT_R
+                                         : s0 * LUMA_WEIGHT_B + s1 * LUMA_WEIGHT_G + s2 * LUMA_WEIGHT_R;
+        dst[k] = (unsigned char)((double)(long long)luma * widthScale + 0.5);  // Signed converts in one instruction
+    }
+}
+
+// Adds one source row to the channel sums of every cell of a text row
+// Sums are 64-bit, so no cell area overflows them (scales go up to INT_MAX, 2^24 pixels of 255 fill 32 bits)
+template <int CHANNELS>
+static inline void sumCellRow(const unsigned char* src, const int* xBounds, int cols, unsigned long long* sums) {
+    for (int j = 0; j < cols; j++) {
+        unsigned long long s0 = 0, s1 = 0, s2 = 0;
+        const unsigned char* p = src + (size_t)xBounds[j] * CHANNELS;
+        const unsigned char* end = src + (size_t)xBounds[j + 1] * CHANNELS;
+        for (; p < end; p += CHANNELS) {
+            s0 += p[0];
+            if (CHANNELS >= 3) {
+                s1 += p[1];
+                s2 += p[2];
+            }
+        }
+        sums[3 * j] += s0;
+        sums[3 * j + 1] += s1;
+        sums[3 * j + 2] += s2;
+    }
+}
+
+// Channel sums of every cell of text row i (sums holds 3 per cell, the alpha of 4 channel images is skipped)
+static inline void sumCellsOfRow(const cv::Mat& src, const int* xBounds, const int* yBounds, int i, int cols, unsigned long long* sums) {
+    memset(sums, 0, (size_t)cols * 3 * sizeof(unsigned long long));
+    for (int y = yBounds[i]; y < yBounds[i + 1]; y++) {
+        switch (src.channels()) {
+            case 1:  sumCellRow<1>(src.ptr<uchar>(y), xBounds, cols, sums); break;
+            case 3:  sumCellRow<3>(src.ptr<uchar>(y), xBounds, cols, sums); break;
+            default: sumCellRow<4>(src.ptr<uchar>(y), xBounds, cols, sums); break;
+        }
+    }
+}
+
+// Averages text row i into BGR cells (bgr, 3 bytes per cell) and/or cell intensities (gray, 1 byte per cell)
+// swapRB reads RGB(A) sources, intensities use the same weights as cv::cvtColor
+static inline void averageCellRow(const cv::Mat& src, const int* xBounds, const int* yBounds, int i, int cols, bool swapRB,
+                                  unsigned long long* sums, uchar* bgr, uchar* gray) {
+    sumCellsOfRow(src, xBounds, yBounds, i, cols, sums);
+    unsigned long long height = (unsigned long long)(yBounds[i + 1] - yBounds[i]);
+    for (int j = 0; j < cols; j++) {
+        unsigned long long area = height * (unsigned long long)(xBounds[j + 1] - xBounds[j]);
+        unsigned int c0 = (unsigned int)((sums[3 * j] + area / 2) / area);
+        unsigned int b = c0, g = c0, r = c0;
+        if (src.channels() > 1) {
+            g = (unsigned int)((sums[3 * j + 1] + area / 2) / area);
+            unsigned int c2 = (unsigned int)((sums[3 * j + 2] + area / 2) / area);
+            b = swapRB ? c2 : c0;
+            r = swapRB ? c0 : c2;
+        }
+        if (bgr != NULL) {
+            bgr[3 * j] = (uchar)b;
+            bgr[3 * j + 1] = (uchar)g;
+            bgr[3 * j + 2] = (uchar)r;
+        }
+        if (gray != NULL) {
+            gray[j] = src.channels() == 1 ? (uchar)c0 : (uchar)colorIntensity(b, g, r);
+        }
+    }
+}
+
+// Averages the source into one BGR (or gray) pixel per cell in a single pass (integer box filter)
+// Only the small cell image is allocated, never a full-size intermediate
+static inline void averageToCells(const cv::Mat& src, const std::vector<int>& xBounds, const std::vector<int>& yBounds,
+                                  bool swapRB, bool gray, cv::Mat& cells, int threads, std::vector<WorkerLoad>* loads = NULL) {
+    int rows = (int)yBounds.size() - 1;
+    int cols = (int)xBounds.size() - 1;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    cells.create(rows, cols, gray ? CV_8UC1 : CV_8UC3);
+
+    parallelForBands(bands, threads, [&](int band) {
+        std::vector<unsigned long long> sums((size_t)cols * 3);
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            averageCellRow(src, xBounds.data(), yBounds.data(), i, cols, swapRB, sums.data(),
+                           gray ? NULL : cells.ptr<uchar>(i), gray ? cells.ptr<uchar>(i) : NULL);
+        }
+    }, loads);
+}
+
+// Halves a BGR or gray image with a 2x2 box average (one pyramid level); odd sizes round up, so the last column
+// and row average the pixels left and every pixel of the half image covers at least one source pixel
+static inline void halveImage(const cv::Mat& src, cv::Mat& dst, int threads, std::vector<WorkerLoad>* loads = NULL) {
+    int width = (src.cols + 1) / 2, height = (src.rows + 1) / 2;
+    std::vector<int> xBounds, yBounds;
+    cellBounds(width, 2, src.cols, 2 * width, xBounds);
+    cellBounds(height, 2, src.rows, 2 * height, yBounds);
+    averageToCells(src, xBounds, yBounds, false, src.channels() == 1, dst, threads, loads);
+}
+
+// Fused text conversion: box average, intensity and glyph of every cell straight into frame
+// (rows * (cols + 1) bytes, breaklines included), without resized or grayscale images
+// ditherPattern (buildOrderedDither()) adds ordered dither offsets before the glyph table, NULL for none
+static inline void averageToGlyphs(const cv::Mat& src, const std::vector<int>& xBounds, const std::vector<int>& yBounds,
+                                   bool swapRB, const unsigned char* glyphLUT, const unsigned char* ditherPattern, char* frame,
+                                   int threads, std::vector<WorkerLoad>* loads = NULL) {
+    int rows = (int)yBounds.size() - 1;
+    int cols = (int)xBounds.size() - 1;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+
+    parallelForBands(bands, threads, [&](int band) {
+        std::vector<unsigned long long> sums((size_t)cols * 3);
+        std::vector<uchar> intensities(cols);
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            averageCellRow(src, xBounds.data(), yBounds.data(), i, cols, swapRB, sums.data(), NULL, intensities.data());
+            if (ditherPattern != NULL) ditherRowOrdered(intensities.data(), cols, i, ditherPattern);
+            char* row = frame + (size_t)i * (cols + 1);
+            mapRowToASCII(intensities.data(), row, cols, glyphLUT);
+            row[cols] = '\n';  // Breakline at the end of each row
+        }
+    }, loads);
+}
+
+#endif
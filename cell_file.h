@@ -0,0 +1,245 @@
+#ifndef CELL_FILE_H
+#define CELL_FILE_H
+
+#include <stdio.h>              // Default lib for input/output
+#include <stdint.h>             // For the fixed-size header fields
+#include <string.h>             // For string manipulation
+#include <strings.h>            // For strcasecmp()
+#include <fcntl.h>              // For open()
+#include <unistd.h>             // For close()
+#include <sys/mman.h>           // For mapping the file
+#include <sys/stat.h>           // For the file size
+#include <sys/uio.h>            // For the row chunks
+#include <vector>               // For the row index and chunks
+#include "ascii_output.h"       // For openOutput() / writeAll() / writevAll()
+
+// Cell file (.cells): the character grid of a conversion, so other views (plain or ANSI text, PNG, a crop) are
+// exported from it without decoding and averaging the source again. Little-endian hosts only, like the result cache
+//   0  "I2AC"            magic
+//   4  u32 version       CELL_FILE_VERSION
+//   8  u32 cols, u32 rows
+//  16  u32 widthScale, u32 heightScale (source pixels per cell)
+//  24  u32 flags         CELL_FILE_*
+//  28  u32 charsetLength (1 - 256)
+//  32  u64 indexOffset   8-aligned, after the charset
+//  40  charset bytes, darkest first
+//  indexOffset: rows + 1 u64 file offsets, row i spans [index[i], index[i + 1])
+//  Row: cols glyph bytes (charset positions), then cols BGR triplets with CELL_FILE_COLOR
+// A reader maps the file and reaches any row through the index, nothing else is parsed
+#define CELL_FILE_MAGIC       "I2AC"
+#define CELL_FILE_VERSION     1
+#define CELL_FILE_HEADER_SIZE 40
+#define CELL_FILE_COLOR       1      // Rows carry the mean BGR color of every cell
+#define CELL_FILE_MAX_CHARSET 256    // Glyphs are stored in one byte
+#define CELL_FILE_ROW_CHUNKS  512    // Rows sent per writev()
+
+// Mapped cell file
+typedef struct {
+    const unsigned char* data;  // Whole file, read only
+    size_t size;
+    int cols;
+    int rows;
+    int widthScale;
+    int heightScale;
+    unsigned int flags;
+    const char* charset;        // charsetLength bytes, not NUL terminated
+    int charsetLength;
+    const unsigned char* index; // rows + 1 offsets
+} CellFile;
+
+// Streams a cell file row by row: the header and index are written up front, since every row has the same size
+typedef struct {
+    int fd;
+    int cols;
+    int rowsLeft;
+    bool color;
+} CellWriter;
+
+static inline uint64_t cellFileRead64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t cellFileRead32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// True if path ends with .cells (any case)
+static inline bool isCellsPath(const char* path) {
+    size_t length = strlen(path);
+    return length >= 6 && strcasecmp(path + length - 6, ".cells") == 0;
+}
+
+// Bytes of one row
+static inline size_t cellFileRowBytes(int cols, bool color) {
+    return (size_t)cols * (color ? 4 : 1);
+}
+
+// Creates path ("-" for stdout) and writes the header and row index of a cols x rows grid (charset darkest first,
+// empty stores a space)
+// Returns 0 on success and -1 on error
+static inline int cellWriterOpen(CellWriter* writer, const char* path, int cols, int rows, int widthScale, int heightScale,
+                                 const char* charset, bool color) {
+    writer->fd = -1;
+    size_t charsetLength = strlen(charset);
+    if (charsetLength == 0) {
+        charset = " ";
+        charsetLength = 1;
+    }
+    if (cols < 1 || rows < 1 || charsetLength > CELL_FILE_MAX_CHARSET) {
+        return -1;
+    }
+    uint64_t indexOffset = (CELL_FILE_HEADER_SIZE + charsetLength + 7) & ~(uint64_t)7;
+    std::vector<unsigned char> head((size_t)indexOffset + ((size_t)rows + 1) * 8, 0);
+    uint32_t fields[7] = {CELL_FILE_VERSION, (uint32_t)cols, (uint32_t)rows, (uint32_t)widthScale, (uint32_t)heightScale,
+                          color ? (uint32_t)CELL_FILE_COLOR : 0u, (uint32_t)charsetLength};
+    memcpy(head.data(), CELL_FILE_MAGIC, 4);
+    memcpy(head.data() + 4, fields, sizeof(fields));
+    memcpy(head.data() + 32, &indexOffset, 8);
+    memcpy(head.data() + CELL_FILE_HEADER_SIZE, charset, charsetLength);
+    uint64_t offset = head.size();
+    for (int i = 0; i <= rows; i++) {
+        memcpy(head.data() + indexOffset + (size_t)i * 8, &offset, 8);
+        offset += cellFileRowBytes(cols, color);
+    }
+
+    writer->fd = openOutput(path);
+    if (writer->fd < 0) {
+        return -1;
+    }
+    if (writeAll(writer->fd, (const char*)head.data(), head.size()) != 0) {
+        close(writer->fd);
+        writer->fd = -1;
+        return -1;
+    }
+    writer->cols = cols;
+    writer->rowsLeft = rows;
+    writer->color = color;
+    return 0;
+}
+
+// Appends count rows: glyphs (cols bytes per row, glyphStride apart) and, for color files, colors (cols * 3 bytes,
+// colorStride apart). The rows are sent straight from the caller buffers with writev(), no copy
+// Returns 0 on success and -1 on error
+static inline int cellWriterRows(CellWriter* writer, const unsigned char* glyphs, size_t glyphStride,
+                                 const unsigned char* colors, size_t colorStride, int count) {
+    if (writer->fd < 0 || count > writer->rowsLeft || (writer->color && colors == NULL)) {
+        return -1;
+    }
+    struct iovec chunks[2 * CELL_FILE_ROW_CHUNKS];
+    for (int first = 0; first < count; first += CELL_FILE_ROW_CHUNKS) {
+        int n = 0;
+        for (int i = first; i < count && i < first + CELL_FILE_ROW_CHUNKS; i++) {
+            chunks[n].iov_base = (void*)(glyphs + (size_t)i * glyphStride);
+            chunks[n++].iov_len = (size_t)writer->cols;
+            if (writer->color) {
+                chunks[n].iov_base = (void*)(colors + (size_t)i * colorStride);
+                chunks[n++].iov_len = (size_t)writer->cols * 3;
+            }
+        }
+        if (writevAll(writer->fd, chunks, n) != 0) {
+            return -1;
+        }
+    }
+    writer->rowsLeft -= count;
+    return 0;
+}
+
+// Closes the file, returns -1 if anything failed or rows are missing
+static inline int cellWriterClose(CellWriter* writer) {
+    if (writer->fd < 0) {
+        return -1;
+    }
+    int status = writer->rowsLeft == 0 ? 0 : -1;
+    if (close(writer->fd) != 0) status = -1;
+    writer->fd = -1;
+    return status;
+}
+
+// Unmaps the file (safe on a failed open)
+static inline void cellFileClose(CellFile* file) {
+    if (file->data != NULL) {
+        munmap((void*)file->data, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+// Maps path and checks the header and every row index entry, never the cells, so opening is linear in the rows only
+// Returns 0 on success and -1 for a missing, truncated or foreign file
+static inline int cellFileOpen(CellFile* file, const char* path) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < CELL_FILE_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    file->data = (const unsigned char*)data;
+    file->size = (size_t)info.st_size;
+
+    const unsigned char* p = file->data;
+    uint32_t cols = cellFileRead32(p + 8), rows = cellFileRead32(p + 12), charsetLength = cellFileRead32(p + 28);
+    uint64_t indexOffset = cellFileRead64(p + 32);
+    if (memcmp(p, CELL_FILE_MAGIC, 4) != 0 || cellFileRead32(p + 4) != CELL_FILE_VERSION || cols < 1 || rows < 1 ||
+        cols > 0x7fffffff || rows > 0x7fffffff || charsetLength < 1 || charsetLength > CELL_FILE_MAX_CHARSET ||
+        indexOffset % 8 != 0 || indexOffset < CELL_FILE_HEADER_SIZE + charsetLength ||
+        indexOffset > file->size || ((uint64_t)rows + 1) * 8 > file->size - indexOffset) {
+        cellFileClose(file);
+        return -1;
+    }
+    file->cols = (int)cols;
+    file->rows = (int)rows;
+    file->widthScale = (int)cellFileRead32(p + 16);
+    file->heightScale = (int)cellFileRead32(p + 20);
+    file->flags = cellFileRead32(p + 24);
+    file->charset = (const char*)p + CELL_FILE_HEADER_SIZE;
+    file->charsetLength = (int)charsetLength;
+    file->index = p + indexOffset;
+
+    // Every row must lie inside the file, after the index, with the size of a row
+    uint64_t rowBytes = cellFileRowBytes(file->cols, (file->flags & CELL_FILE_COLOR) != 0);
+    uint64_t previous = indexOffset + ((uint64_t)rows + 1) * 8;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint64_t start = cellFileRead64(file->index + (size_t)i * 8), end = cellFileRead64(file->index + (size_t)(i + 1) * 8);
+        if (start < previous || end < start || end - start != rowBytes || end > file->size) {
+            cellFileClose(file);
+            return -1;
+        }
+        previous = end;
+    }
+    return 0;
+}
+
+// Glyphs (cols charset positions) and colors (cols BGR triplets, NULL without CELL_FILE_COLOR) of row i
+static inline void cellFileRow(const CellFile* file, int i, const unsigned char** glyphs, const unsigned char** colors) {
+    const unsigned char* row = file->data + cellFileRead64(file->index + (size_t)i * 8);
+    *glyphs = row;
+    if (colors != NULL) *colors = (file->flags & CELL_FILE_COLOR) ? row + file->cols : NULL;
+}
+
+// Character of a stored glyph (positions past the charset show the brightest glyph)
+static inline char cellFileGlyph(const CellFile* file, unsigned char glyph) {
+    return file->charset[glyph < file->charsetLength ? glyph : file->charsetLength - 1];
+}
+
+// Hints the kernel to read rows [first, first + count) ahead, before an export walks them
+static inline void cellFilePrefetch(const CellFile* file, int first, int count) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t start = (size_t)cellFileRead64(file->index + (size_t)first * 8);
+    size_t end = (size_t)cellFileRead64(file->index + (size_t)(first + count) * 8);
+    size_t aligned = start - start % (size_t)page;
+    madvise((void*)(file->data + aligned), end - aligned, MADV_WILLNEED);
+}
+
+#endif
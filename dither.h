@@ -0,0 +1,198 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+#include <atomic>               // For the row progress of the wavefront
+#include <memory>               // For the progress counters
+#include <string>               // For the self-test charsets
+#include <vector>               // For the error rows
+#include "thread_pool.h"        // For the wavefront workers and their loads
+
+// SSE2 is part of every x86-64 CPU, so the ordered dither kernel needs no run-time dispatch
+#if defined(__SSE2__)
+#include <emmintrin.h>          // For SSE2 intrinsics
+#define DITHER_SSE2 1
+#endif
+
+#define DITHER_BAYER_SIZE   4                       // Side of the ordered dither matrix
+#define DITHER_PATTERN_SIZE (DITHER_BAYER_SIZE * 16) // One 16 byte pattern per matrix row
+#define DITHER_FS_CHUNK     64                      // Cells a Floyd-Steinberg row finishes before the row below may follow
+
+// 4x4 Bayer matrix (thresholds 0 - 15)
+static const unsigned char ditherBayer[DITHER_BAYER_SIZE][DITHER_BAYER_SIZE] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+// Builds the ordered dither offsets of a charset: row r of the matrix repeated over 16 bytes per pattern row
+// The glyph table floors intensity * (len - 1) / 255, so adding (threshold + 1/2) / 16 of a glyph step before it
+// picks the upper glyph for the right share of the cells (an empty or single glyph charset gets no offsets)
+static inline void buildOrderedDither(const char* asciiChars, unsigned char pattern[DITHER_PATTERN_SIZE]) {
+    int len = strlen(asciiChars);
+    for (int r = 0; r < DITHER_BAYER_SIZE; r++) {
+        for (int k = 0; k < 16; k++) {
+            int threshold = ditherBayer[r][k % DITHER_BAYER_SIZE];
+            pattern[16 * r + k] = (unsigned char)(len > 1 ? ((2 * threshold + 1) * 255 + 16 * (len - 1)) / (32 * (len - 1)) : 0);
+        }
+    }
+}
+
+// Adds the offsets of text row i to n intensities (saturating at 255, the brightest glyph)
+// Reference version (one cell at a time), the SSE2 kernel below must always match it
+static inline void ditherRowOrderedScalar(unsigned char* intensities, int n, int i, const unsigned char* pattern) {
+    const unsigned char* offsets = pattern + 16 * (i % DITHER_BAYER_SIZE);
+    for (int j = 0; j < n; j++) {
+        int value = intensities[j] + offsets[j % DITHER_BAYER_SIZE];
+        intensities[j] = (unsigned char)(value < 255 ? value : 255);
+    }
+}
+
+#ifdef DITHER_SSE2
+// SSE2 kernel: 16 cells per saturating add, the pattern repeats every 4 cells so every step starts in phase
+static inline void ditherRowOrderedSSE2(unsigned char* intensities, int n, int i, const unsigned char* pattern) {
+    const unsigned char* offsets = pattern + 16 * (i % DITHER_BAYER_SIZE);
+    __m128i add = _mm_loadu_si128((const __m128i*)offsets);
+    int j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m128i values = _mm_loadu_si128((const __m128i*)(intensities + j));
+        _mm_storeu_si128((__m128i*)(intensities + j), _mm_adds_epu8(values, add));
+    }
+    for (; j < n; j++) {
+        int value = intensities[j] + offsets[j % DITHER_BAYER_SIZE];
+        intensities[j] = (unsigned char)(value < 255 ? value : 255);
+    }
+}
+#endif
+
+// Adds the ordered dither offsets of text row i to a row of intensities
+static inline void ditherRowOrdered(unsigned char* intensities, int n, int i, const unsigned char* pattern) {
+#ifdef DITHER_SSE2
+    ditherRowOrderedSSE2(intensities, n, i, pattern);
+#else
+    ditherRowOrderedScalar(intensities, n, i, pattern);
+#endif
+}
+
+// Floyd-Steinberg text row i: quantizes the cells to the nearest glyph level and pushes the error right (7/16) and
+// into errors of the row below (3/16, 5/16, 1/16). Errors are integers in 1/16 of an intensity step and the last share
+// takes the remainder, so no error is lost and the result is exact. below holds cols + 2 entries (one guard each side)
+// progress, when given, publishes the cells done every DITHER_FS_CHUNK, and above (progress of row i - 1) is waited on
+// so row i only reads an error of the row above once every cell that adds to it is finished
+static inline void floydSteinbergRow(const unsigned char* gray, int cols, const char* glyphs, int levels, const int* incoming,
+                                     int* below, char* dst, const std::atomic<int>* above, std::atomic<int>* progress) {
+    const int white = 255 * 16;
+    int carry = 0;
+    int ready = above != NULL ? 0 : cols;
+    for (int j = 0; j < cols; j++) {
+        // Cell j takes errors from cells j - 1, j and j + 1 of the row above
+        int needed = j + 2 < cols ? j + 2 : cols;
+        while (ready < needed) {
+            ready = above->load(std::memory_order_acquire);
+            if (ready < needed) std::this_thread::yield();
+        }
+        int value = gray[j] * 16 + incoming[j + 1] + carry;
+        int clamped = value < 0 ? 0 : (value > white ? white : value);
+        int level = levels > 1 ? (clamped * (levels - 1) + white / 2) / white : 0;
+        dst[j] = glyphs[level];
+        // The error of the clamped value, so errors cannot pile up past black or white
+        int error = levels > 1 ? clamped - level * white / (levels - 1) : 0;
+        int right = error * 7 / 16, downLeft = error * 3 / 16, down = error * 5 / 16;
+        carry = right;
+        below[j] += downLeft;
+        below[j + 1] += down;
+        below[j + 2] += error - right - downLeft - down;
+        if (progress != NULL && ((j + 1) % DITHER_FS_CHUNK == 0 || j + 1 == cols)) {
+            progress->store(j + 1, std::memory_order_release);
+        }
+    }
+}
+
+// Floyd-Steinberg text conversion of cell intensities (rows x cols, stride bytes apart) straight into frame
+// (rows * (cols + 1) bytes, breaklines included); glyphs is the charset, darkest first
+// Rows are dealt round-robin to the threads and each follows the row above on a diagonal wavefront, DITHER_FS_CHUNK
+// cells behind, so threads work on consecutive rows at once. Every cell sees the same errors in the same order
+// whatever the thread count, so the text is identical on 1 or 64 threads
+static inline void floydSteinbergToGlyphs(const unsigned char* gray, size_t stride, int rows, int cols, const char* glyphs,
+                                          char* frame, int threads, std::vector<WorkerLoad>* loads = NULL) {
+    static const char space[] = " ";
+    int levels = strlen(glyphs);
+    if (levels == 0) {
+        glyphs = space;  // An empty charset maps everything to a space
+        levels = 1;
+    }
+    if (threads > rows) threads = rows;
+    if (threads < 1) threads = 1;
+    if (loads != NULL && (int)loads->size() < threads) {
+        loads->resize(threads);
+    }
+
+    // Errors flowing into every row (cols + 2 entries each), the cell grid is small next to the source pixels
+    std::vector<int> errors((size_t)(rows + 1) * (cols + 2), 0);
+    std::unique_ptr<std::atomic<int>[]> progress(new std::atomic<int>[rows]);
+    for (int i = 0; i < rows; i++) progress[i].store(0, std::memory_order_relaxed);
+
+    auto worker = [&](int t) {
+        double start = loads != NULL ? monotonicSeconds() : 0.0;
+        int done = 0;
+        for (int i = t; i < rows; i += threads) {
+            char* row = frame + (size_t)i * (cols + 1);
+            floydSteinbergRow(gray + (size_t)i * stride, cols, glyphs, levels, &errors[(size_t)i * (cols + 2)],
+                              &errors[(size_t)(i + 1) * (cols + 2)], row, i > 0 && threads > 1 ? &progress[i - 1] : NULL,
+                              threads > 1 ? &progress[i] : NULL);
+            row[cols] = '\n';  // Breakline at the end of each row
+            done++;
+        }
+        if (loads != NULL) {
+            (*loads)[t].bands += done;
+            (*loads)[t].busySeconds += monotonicSeconds() - start;
+        }
+    };
+
+    runOnThreads(threads, worker);
+}
+
+// Checks the ordered dither kernel against the scalar one and Floyd-Steinberg on 2 to 8 threads against 1 thread
+// Returns the number of mismatches
+static inline int ditherSelfTest(void) {
+    int failures = 0;
+    const int rows = 37, cols = 203;  // Chunks of the wavefront and SIMD steps with tails
+    std::vector<unsigned char> gray((size_t)rows * cols);
+    unsigned int seed = 777;
+    for (size_t k = 0; k < gray.size(); k++) {
+        seed = seed * 1103515245u + 12345u;
+        gray[k] = (unsigned char)(k % 5 == 0 ? (seed >> 16) : (k / cols) * 7 + (k % cols));  // Gradients and noise
+    }
+
+#ifdef DITHER_SSE2
+    unsigned char pattern[DITHER_PATTERN_SIZE];
+    for (int len = 1; len <= 100; len++) {
+        std::string charset((size_t)len, '#');
+        buildOrderedDither(charset.c_str(), pattern);
+        for (int i = 0; i < DITHER_BAYER_SIZE; i++) {
+            std::vector<unsigned char> expected(gray.begin(), gray.begin() + cols), row(expected);
+            ditherRowOrderedScalar(expected.data(), cols, i, pattern);
+            ditherRowOrderedSSE2(row.data(), cols, i, pattern);
+            if (row != expected) {
+                printf("Mismatch: ordered dither kernel sse2, charset length %d\n", len);
+                failures++;
+                break;
+            }
+        }
+    }
+#endif
+
+    const char* charsets[2] = {" .:-=+*#%@", " @"};
+    for (int c = 0; c < 2; c++) {
+        std::vector<char> expected((size_t)rows * (cols + 1)), frame(expected.size());
+        floydSteinbergToGlyphs(gray.data(), cols, rows, cols, charsets[c], expected.data(), 1);
+        for (int threads = 2; threads <= 8; threads++) {
+            floydSteinbergToGlyphs(gray.data(), cols, rows, cols, charsets[c], frame.data(), threads);
+            if (frame != expected) {
+                printf("Mismatch: Floyd-Steinberg on %d threads, charset \"%s\"\n", threads, charsets[c]);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+#endif
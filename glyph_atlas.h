@@ -0,0 +1,137 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include "ascii_lut.h"          // For the glyph of a cell color
+
+// SSE2 is part of every x86-64 CPU, so the tint kernel needs no runtime dispatch
+#if defined(__SSE2__)
+#include <emmintrin.h>          // For SSE2 intrinsics
+#define GLYPH_ATLAS_SSE2 1
+#endif
+
+#define GLYPH_ATLAS_FONT_SCALE 0.5  // Same font size the per cell cv::putText used
+
+// Glyph atlas: every charset glyph is rasterized once into a widthScale x heightScale alpha mask
+// Masks are stored with the alpha repeated for the 3 channels, so a mask row lines up byte for byte with a BGR canvas row
+typedef struct {
+    int widthScale;         // Cell width in pixels
+    int heightScale;        // Cell height in pixels
+    int rowBytes;           // widthScale * 3
+    short slot[256];        // Mask index of each character, -1 if not in the charset
+    unsigned char* masks;   // slots * heightScale * rowBytes alpha bytes
+} GlyphAtlas;
+
+// Renders every distinct character of the charset (antialiased, baseline at the bottom of the cell)
+// Returns 0 on success and -1 on error
+static inline int glyphAtlasBuild(GlyphAtlas* atlas, const char* asciiChars, int widthScale, int heightScale) {
+    memset(atlas, 0, sizeof(*atlas));
+    atlas->widthScale = widthScale;
+    atlas->heightScale = heightScale;
+    atlas->rowBytes = widthScale * 3;
+    for (int c = 0; c < 256; c++) atlas->slot[c] = -1;
+
+    int slots = 0;
+    for (const char* p = asciiChars; *p != '\0'; p++) {
+        if (atlas->slot[(unsigned char)*p] < 0) atlas->slot[(unsigned char)*p] = (short)slots++;
+    }
+
+    size_t maskBytes = (size_t)heightScale * atlas->rowBytes;
+    atlas->masks = (unsigned char*)calloc(slots > 0 ? slots * maskBytes : 1, 1);
+    if (atlas->masks == NULL) return -1;
+
+    cv::Mat cell(heightScale, widthScale, CV_8UC1);
+    for (int c = 0; c < 256; c++) {
+        if (atlas->slot[c] < 0) continue;
+        cell.setTo(cv::Scalar(0));
+        cv::putText(cell, std::string(1, (char)c), cv::Point(0, heightScale), cv::FONT_HERSHEY_SIMPLEX,
+                    GLYPH_ATLAS_FONT_SCALE, cv::Scalar(255), 1, cv::LINE_AA);
+
+        unsigned char* mask = atlas->masks + atlas->slot[c] * maskBytes;
+        for (int y = 0; y < heightScale; y++) {
+            const uchar* alpha = cell.ptr<uchar>(y);
+            unsigned char* maskRow = mask + (size_t)y * atlas->rowBytes;
+            for (int x = 0; x < widthScale; x++) {
+                maskRow[3 * x] = maskRow[3 * x + 1] = maskRow[3 * x + 2] = alpha[x];
+            }
+        }
+    }
+    return 0;
+}
+
+// Frees the masks
+static inline void glyphAtlasFree(GlyphAtlas* atlas) {
+    free(atlas->masks);
+    atlas->masks = NULL;
+}
+
+// Alpha-multiplies one mask row by a BGR color into the canvas: dst = alpha * color / 255 (rounded)
+static inline void tintMaskRow(const unsigned char* mask, unsigned char* dst, int n, const unsigned char bgr[3]) {
+    int k = 0;
+#ifdef GLYPH_ATLAS_SSE2
+    // 16 bytes are not a multiple of 3 channels, so the color pattern repeats every 3 vectors (48 bytes)
+    unsigned char pattern[48];
+    for (int b = 0; b < 48; b++) pattern[b] = bgr[b % 3];
+    __m128i tint[3];
+    for (int v = 0; v < 3; v++) tint[v] = _mm_loadu_si128((const __m128i*)(pattern + 16 * v));
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+    for (int v = 0; k + 16 <= n; k += 16, v = (v == 2) ? 0 : v + 1) {
+        __m128i alpha = _mm_loadu_si128((const __m128i*)(mask + k));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(alpha, zero), _mm_unpacklo_epi8(tint[v], zero)), half);
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(alpha, zero), _mm_unpackhi_epi8(tint[v], zero)), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);  // x / 255 rounded
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; k < n; k++) {
+        int x = mask[k] * bgr[k % 3] + 128;
+        dst[k] = (unsigned char)((x + (x >> 8)) >> 8);
+    }
+}
+
+// Renders text row i of the colored canvas (heightScale pixel rows) from the BGR cell image
+// Each cell copies its glyph mask tinted with the cell color, one contiguous store per pixel row
+static inline void glyphAtlasRenderRow(const GlyphAtlas* atlas, const cv::Mat& image, int i, const unsigned char* glyphLUT, cv::Mat& output) {
+    const uchar* pixelRow = image.ptr<uchar>(i);
+    size_t maskBytes = (size_t)atlas->heightScale * atlas->rowBytes;
+
+    for (int j = 0; j < image.cols; j++) {
+        const unsigned char* bgr = pixelRow + 3 * j;                      // Color (BGR)
+        short slot = atlas->slot[colorToGlyph(bgr, glyphLUT)];            // Same glyph as the cell files and ANSI text
+        for (int y = 0; y < atlas->heightScale; y++) {
+            unsigned char* dst = output.ptr<uchar>(i * atlas->heightScale + y) + (size_t)j * atlas->rowBytes;
+            if (slot < 0) {
+                memset(dst, 0, atlas->rowBytes);  // Character without glyph (empty charset)
+            } else {
+                tintMaskRow(atlas->masks + slot * maskBytes + (size_t)y * atlas->rowBytes, dst, atlas->rowBytes, bgr);
+            }
+        }
+    }
+}
+
+// Renders one text row from stored cells: characters (glyphs) tinted with BGR colors (3 bytes per cell, NULL for white)
+// into heightScale canvas rows starting at dst, stride bytes apart
+static inline void glyphAtlasRenderCells(const GlyphAtlas* atlas, const unsigned char* glyphs, const unsigned char* colors,
+                                         int cols, unsigned char* dst, size_t stride) {
+    static const unsigned char white[3] = {255, 255, 255};
+    size_t maskBytes = (size_t)atlas->heightScale * atlas->rowBytes;
+    for (int j = 0; j < cols; j++) {
+        const unsigned char* bgr = colors != NULL ? colors + 3 * j : white;
+        short slot = atlas->slot[glyphs[j]];
+        for (int y = 0; y < atlas->heightScale; y++) {
+            unsigned char* pixels = dst + (size_t)y * stride + (size_t)j * atlas->rowBytes;
+            if (slot < 0) {
+                memset(pixels, 0, atlas->rowBytes);  // Character without glyph
+            } else {
+                tintMaskRow(atlas->masks + slot * maskBytes + (size_t)y * atlas->rowBytes, pixels, atlas->rowBytes, bgr);
+            }
+        }
+    }
+}
+
+#endif
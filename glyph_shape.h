@@ -0,0 +1,379 @@
+#ifndef GLYPH_SHAPE_H
+#define GLYPH_SHAPE_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <limits.h>             // For INT_MAX
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <algorithm>            // For std::min()
+#include <vector>               // For the subcell bounds and sums
+#include "cell_average.h"       // For the subcell averages and the band scheduler
+
+// SSE2 is part of every x86-64 CPU, AVX2 is picked at run time like the glyph table kernels
+#if defined(__SSE2__)
+#include <emmintrin.h>          // For SSE2 intrinsics
+#define GLYPH_SHAPE_SSE2 1
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>          // For AVX2 intrinsics
+#define GLYPH_SHAPE_X86 1
+#endif
+
+#define SHAPE_GRID        4                          // Subcells per side of a cell
+#define SHAPE_FEATURE     (SHAPE_GRID * SHAPE_GRID)  // Bytes of a feature vector (one SSE register)
+#define SHAPE_FONT_SCALE  1.0                        // Glyphs are rasterized large, then area-averaged to the grid
+#define SHAPE_MAX_SUM     (SHAPE_FEATURE * 255)      // Largest coverage sum of a feature vector
+#define SHAPE_CANDIDATES  16                         // Glyphs measured first per cell, the nearest in coverage sum (even)
+
+// Distance and glyph index as one key, so the nearest glyph is a plain minimum and ties go to the lower glyph index
+// (distances take 12 bits and glyph indexes 8, charsets have at most 256 glyphs with the padding)
+#define SHAPE_KEY(distance, glyph) (((unsigned int)(distance) << 8) | (unsigned int)(glyph))
+#define SHAPE_KEY_DISTANCE(key)    ((int)((key) >> 8))
+#define SHAPE_KEY_GLYPH(key)       ((int)((key) & 0xFF))
+
+// Glyph shapes: every distinct charset glyph as a 4x4 coverage vector (row-major, 0 - 255)
+// Coverage is scaled so the densest glyph has the mean of a white cell, like the brightness mapping
+// Matching is exact: a cell is measured first against the SHAPE_CANDIDATES glyphs nearest to its brightness
+// (coverage sum), then the search widens while a glyph further out can still be as near; the difference of two
+// coverage sums never exceeds their distance, so long charsets usually cost the same per cell as a short one
+typedef struct {
+    int count;                  // Glyphs, padded to an even count with a copy of the last one (AVX2 takes pairs)
+    char glyphs[258];
+    unsigned char* features;    // count * SHAPE_FEATURE bytes
+    unsigned char* sorted;      // The features again, in increasing coverage sum order (glyphShapesIndex())
+    unsigned short sortedGlyph[258];                // Glyph index of each sorted feature
+    unsigned short sortedSum[258];                  // Coverage sum of each sorted feature
+    unsigned long long sortedTag[2 * 258];          // sortedGlyph twice per feature, the 64-bit lanes of the AVX2 keys
+    int candidates;                                 // Glyphs measured first per cell (even, at most count)
+    unsigned short windowStart[SHAPE_MAX_SUM + 1];  // First sorted feature measured for a cell of each sum
+} GlyphShapes;
+
+// Builds the coverage sum order and the first window of every cell sum (count and features must be set)
+// Windows are centered on the first glyph at least as bright as the cell and clamped to the charset
+// Returns 0 on success and -1 on error
+static inline int glyphShapesIndex(GlyphShapes* shapes) {
+    int count = shapes->count;
+    shapes->sorted = (unsigned char*)malloc((size_t)count * SHAPE_FEATURE);
+    if (shapes->sorted == NULL) return -1;
+    int sums[258];
+    for (int g = 0; g < count; g++) {
+        sums[g] = 0;
+        for (int k = 0; k < SHAPE_FEATURE; k++) sums[g] += shapes->features[(size_t)g * SHAPE_FEATURE + k];
+        int k = g;  // Insertion in sum order, equal sums keep glyph order
+        for (; k > 0 && sums[shapes->sortedGlyph[k - 1]] > sums[g]; k--) shapes->sortedGlyph[k] = shapes->sortedGlyph[k - 1];
+        shapes->sortedGlyph[k] = (unsigned short)g;
+    }
+    for (int k = 0; k < count; k++) {
+        memcpy(shapes->sorted + (size_t)k * SHAPE_FEATURE, shapes->features + (size_t)shapes->sortedGlyph[k] * SHAPE_FEATURE,
+               SHAPE_FEATURE);
+        shapes->sortedSum[k] = (unsigned short)sums[shapes->sortedGlyph[k]];
+        shapes->sortedTag[2 * k] = shapes->sortedTag[2 * k + 1] = shapes->sortedGlyph[k];
+    }
+    shapes->candidates = count < SHAPE_CANDIDATES ? count : SHAPE_CANDIDATES;
+    int first = 0;
+    for (int sum = 0; sum <= SHAPE_MAX_SUM; sum++) {
+        while (first < count && sums[shapes->sortedGlyph[first]] < sum) first++;
+        int start = first - shapes->candidates / 2;
+        if (start > count - shapes->candidates) start = count - shapes->candidates;
+        shapes->windowStart[sum] = (unsigned short)(start > 0 ? start : 0);
+    }
+    return 0;
+}
+
+// Rasterizes every distinct character of the charset into its feature vector
+// An empty charset becomes a single space. Returns 0 on success and -1 on error
+static inline int glyphShapesBuild(GlyphShapes* shapes, const char* asciiChars) {
+    memset(shapes, 0, sizeof(*shapes));
+    bool seen[256] = {false};
+    int count = 0;
+    for (const char* p = asciiChars; *p != '\0'; p++) {
+        if (!seen[(unsigned char)*p]) {
+            seen[(unsigned char)*p] = true;
+            shapes->glyphs[count++] = *p;
+        }
+    }
+    if (count == 0) shapes->glyphs[count++] = ' ';
+    if (count % 2 != 0) shapes->glyphs[count] = shapes->glyphs[count - 1];
+    shapes->count = count + count % 2;
+    shapes->features = (unsigned char*)calloc((size_t)shapes->count * SHAPE_FEATURE, 1);
+    if (shapes->features == NULL) return -1;
+
+    // Monospaced box: the widest glyph by the full ascent + descent, glyphs sit on a shared baseline, centered across
+    int baseline = 0;
+    cv::Size box = cv::getTextSize("Mg|", cv::FONT_HERSHEY_SIMPLEX, SHAPE_FONT_SCALE, 1, &baseline);
+    std::vector<int> glyphWidths(count);
+    int width = 1;
+    for (int g = 0; g < count; g++) {
+        int glyphBaseline;
+        cv::Size size = cv::getTextSize(std::string(1, shapes->glyphs[g]), cv::FONT_HERSHEY_SIMPLEX, SHAPE_FONT_SCALE, 1,
+                                        &glyphBaseline);
+        glyphWidths[g] = size.width;
+        if (size.width > width) width = size.width;
+    }
+
+    std::vector<float> coverage((size_t)count * SHAPE_FEATURE);
+    float densest = 0.0f;
+    cv::Mat glyph(box.height + baseline, width, CV_8UC1), grid;
+    for (int g = 0; g < count; g++) {
+        glyph.setTo(cv::Scalar(0));
+        cv::putText(glyph, std::string(1, shapes->glyphs[g]), cv::Point((width - glyphWidths[g]) / 2, box.height),
+                    cv::FONT_HERSHEY_SIMPLEX, SHAPE_FONT_SCALE, cv::Scalar(255), 1, cv::LINE_AA);
+        cv::resize(glyph, grid, cv::Size(SHAPE_GRID, SHAPE_GRID), 0, 0, cv::INTER_AREA);
+        float mean = 0.0f;
+        for (int k = 0; k < SHAPE_FEATURE; k++) {
+            coverage[(size_t)g * SHAPE_FEATURE + k] = grid.ptr<uchar>(k / SHAPE_GRID)[k % SHAPE_GRID];
+            mean += coverage[(size_t)g * SHAPE_FEATURE + k] / SHAPE_FEATURE;
+        }
+        if (mean > densest) densest = mean;
+    }
+
+    float gain = densest > 0.0f ? 255.0f / densest : 1.0f;
+    for (int g = 0; g < shapes->count; g++) {
+        int source = g < count ? g : count - 1;
+        for (int k = 0; k < SHAPE_FEATURE; k++) {
+            float value = coverage[(size_t)source * SHAPE_FEATURE + k] * gain + 0.5f;
+            shapes->features[(size_t)g * SHAPE_FEATURE + k] = (unsigned char)(value < 255.0f ? value : 255.0f);
+        }
+    }
+    return glyphShapesIndex(shapes);
+}
+
+// Frees the feature vectors
+static inline void glyphShapesFree(GlyphShapes* shapes) {
+    free(shapes->features);
+    free(shapes->sorted);
+    shapes->features = NULL;
+    shapes->sorted = NULL;
+}
+
+// Match kernel signature: picks the glyph of n cells (SHAPE_FEATURE bytes each) into dst
+// The smallest sum of absolute differences over every glyph wins, the lowest glyph index on ties
+typedef void (*ShapeMatchKernel)(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst);
+
+// Key of sorted glyph c against a cell (scalar)
+static inline unsigned int shapeKeyScalar(const unsigned char* cell, const GlyphShapes* shapes, int c) {
+    const unsigned char* feature = shapes->sorted + (size_t)c * SHAPE_FEATURE;
+    int distance = 0;
+    for (int k = 0; k < SHAPE_FEATURE; k++) distance += abs((int)cell[k] - (int)feature[k]);
+    return SHAPE_KEY(distance, shapes->sortedGlyph[c]);
+}
+
+static inline void matchShapesScalar(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst) {
+    for (int j = 0; j < n; j++) {
+        const unsigned char* cell = cells + (size_t)j * SHAPE_FEATURE;
+        int sum = 0;
+        for (int k = 0; k < SHAPE_FEATURE; k++) sum += cell[k];
+        int start = shapes->windowStart[sum], end = start + shapes->candidates;
+        unsigned int best = ~0u;
+        for (int c = start; c < end; c++) best = std::min(best, shapeKeyScalar(cell, shapes, c));
+        for (int c = start - 1; c >= 0 && sum - shapes->sortedSum[c] <= SHAPE_KEY_DISTANCE(best); c--) {
+            best = std::min(best, shapeKeyScalar(cell, shapes, c));
+        }
+        for (int c = end; c < shapes->count && shapes->sortedSum[c] - sum <= SHAPE_KEY_DISTANCE(best); c++) {
+            best = std::min(best, shapeKeyScalar(cell, shapes, c));
+        }
+        dst[j] = shapes->glyphs[SHAPE_KEY_GLYPH(best)];
+    }
+}
+
+#ifdef GLYPH_SHAPE_SSE2
+// Key of sorted glyph c against a cell: one psadbw gives the whole 16 byte distance in two halves
+static inline unsigned int shapeKeySSE2(__m128i cell, const GlyphShapes* shapes, int c) {
+    __m128i sad = _mm_sad_epu8(cell, _mm_loadu_si128((const __m128i*)(shapes->sorted + (size_t)c * SHAPE_FEATURE)));
+    return SHAPE_KEY(_mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4), shapes->sortedGlyph[c]);
+}
+
+// Glyphs outside [start, end) that can still be as near as best (the cell sum against zero gives the bound)
+static inline unsigned int widenShapesSSE2(__m128i cell, int sum, int start, int end, const GlyphShapes* shapes,
+                                           unsigned int best) {
+    for (int c = start - 1; c >= 0 && sum - shapes->sortedSum[c] <= SHAPE_KEY_DISTANCE(best); c--) {
+        best = std::min(best, shapeKeySSE2(cell, shapes, c));
+    }
+    for (int c = end; c < shapes->count && shapes->sortedSum[c] - sum <= SHAPE_KEY_DISTANCE(best); c++) {
+        best = std::min(best, shapeKeySSE2(cell, shapes, c));
+    }
+    return best;
+}
+
+// SSE2 kernel: one psadbw per glyph
+static inline void matchShapesSSE2(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst) {
+    __m128i zero = _mm_setzero_si128();
+    for (int j = 0; j < n; j++) {
+        __m128i cell = _mm_loadu_si128((const __m128i*)(cells + (size_t)j * SHAPE_FEATURE));
+        __m128i total = _mm_sad_epu8(cell, zero);
+        int sum = _mm_cvtsi128_si32(total) + _mm_extract_epi16(total, 4);
+        int start = shapes->windowStart[sum], end = start + shapes->candidates;
+        unsigned int best = ~0u;
+        for (int c = start; c < end; c++) best = std::min(best, shapeKeySSE2(cell, shapes, c));
+        dst[j] = shapes->glyphs[SHAPE_KEY_GLYPH(widenShapesSSE2(cell, sum, start, end, shapes, best))];
+    }
+}
+#endif
+
+#if defined(GLYPH_SHAPE_X86) && defined(GLYPH_SHAPE_SSE2)
+// AVX2 kernel: two glyphs per vpsadbw in the first window, against the cell broadcast to both lanes (windows have
+// an even size), keys kept in a register until the window ends; the few glyphs of the widening one at a time
+__attribute__((target("avx2")))
+static void matchShapesAVX2(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst) {
+    for (int j = 0; j < n; j++) {
+        __m128i cell128 = _mm_loadu_si128((const __m128i*)(cells + (size_t)j * SHAPE_FEATURE));
+        __m128i total = _mm_sad_epu8(cell128, _mm_setzero_si128());
+        int sum = _mm_cvtsi128_si32(total) + _mm_extract_epi16(total, 4);
+        int start = shapes->windowStart[sum], end = start + shapes->candidates;
+        __m256i cell = _mm256_broadcastsi128_si256(cell128);
+        __m256i keys = _mm256_set1_epi32(-1);
+        for (int c = start; c < end; c += 2) {
+            __m256i sad = _mm256_sad_epu8(cell, _mm256_loadu_si256((const __m256i*)(shapes->sorted + (size_t)c * SHAPE_FEATURE)));
+            // Lanes: glyph c low/high half, glyph c + 1 low/high half -> one sum per glyph in every 64-bit lane
+            __m256i sums = _mm256_add_epi64(sad, _mm256_shuffle_epi32(sad, _MM_SHUFFLE(1, 0, 3, 2)));
+            __m256i tags = _mm256_loadu_si256((const __m256i*)(shapes->sortedTag + 2 * c));
+            keys = _mm256_min_epu32(keys, _mm256_or_si256(_mm256_slli_epi64(sums, 8), tags));
+        }
+        // The keys are the even 32-bit lanes (the odd ones hold the zero high halves)
+        __m128i half = _mm_min_epu32(_mm256_castsi256_si128(keys), _mm256_extracti128_si256(keys, 1));
+        unsigned int best = std::min((unsigned int)_mm_cvtsi128_si32(half), (unsigned int)_mm_extract_epi32(half, 2));
+        dst[j] = shapes->glyphs[SHAPE_KEY_GLYPH(widenShapesSSE2(cell128, sum, start, end, shapes, best))];
+    }
+}
+#endif
+
+// Picks the best kernel supported by the running CPU
+static inline ShapeMatchKernel selectShapeMatchKernel(void) {
+#if defined(GLYPH_SHAPE_X86) && defined(GLYPH_SHAPE_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return matchShapesAVX2;
+    }
+#endif
+#ifdef GLYPH_SHAPE_SSE2
+    return matchShapesSSE2;
+#else
+    return matchShapesScalar;
+#endif
+}
+
+// Picks the glyphs of a row of cells (dispatch is resolved once)
+static inline void matchShapes(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst) {
+    static const ShapeMatchKernel kernel = selectShapeMatchKernel();
+    kernel(cells, n, shapes, dst);
+}
+
+// Brute force reference of the kernels: every glyph in charset order, no window and no bound
+static inline void matchShapesExhaustive(const unsigned char* cells, int n, const GlyphShapes* shapes, char* dst) {
+    for (int j = 0; j < n; j++) {
+        const unsigned char* cell = cells + (size_t)j * SHAPE_FEATURE;
+        int best = INT_MAX, bestGlyph = 0;
+        for (int g = 0; g < shapes->count; g++) {
+            const unsigned char* feature = shapes->features + (size_t)g * SHAPE_FEATURE;
+            int distance = 0;
+            for (int k = 0; k < SHAPE_FEATURE; k++) distance += abs((int)cell[k] - (int)feature[k]);
+            if (distance < best) {
+                best = distance;
+                bestGlyph = g;
+            }
+        }
+        dst[j] = shapes->glyphs[bestGlyph];
+    }
+}
+
+// Checks every match kernel available on this CPU against the exhaustive search
+// Random features for every glyph count from 1 to 100 (coarse, so ties happen, and spread over a narrow or the
+// whole coverage range, so the window and the widening both decide), returns the number of mismatches
+static inline int glyphShapesSelfTest(void) {
+    ShapeMatchKernel kernels[3] = {matchShapesScalar, NULL, NULL};
+    const char* kernelNames[3] = {"scalar", "sse2", "avx2"};
+#ifdef GLYPH_SHAPE_SSE2
+    kernels[1] = matchShapesSSE2;
+#endif
+#if defined(GLYPH_SHAPE_X86) && defined(GLYPH_SHAPE_SSE2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels[2] = matchShapesAVX2;
+#endif
+
+    const int n = 1024;
+    std::vector<unsigned char> cells((size_t)n * SHAPE_FEATURE);
+    std::vector<unsigned char> features(100 * SHAPE_FEATURE);
+    unsigned int seed = 12345;
+    for (size_t k = 0; k < cells.size(); k++) {
+        seed = seed * 1103515245u + 12345u;
+        cells[k] = (unsigned char)((seed >> 16) & (k / SHAPE_FEATURE % 2 == 0 ? 0xFF : 0xF0));
+    }
+
+    int failures = 0;
+    std::vector<char> expected(n), dst(n);
+    for (int spread = 0; spread < 2; spread++) {
+        for (size_t k = 0; k < features.size(); k++) {
+            seed = seed * 1103515245u + 12345u;
+            unsigned char value = (unsigned char)((seed >> 16) & 0xF0);
+            features[k] = spread == 0 ? (unsigned char)(96 + value / 4) : value;
+        }
+        for (int count = 1; count <= 99; count++) {
+            GlyphShapes shapes;
+            memset(&shapes, 0, sizeof(shapes));
+            for (int g = 0; g < count; g++) shapes.glyphs[g] = (char)(' ' + g % 95);
+            if (count % 2 != 0) {
+                shapes.glyphs[count] = shapes.glyphs[count - 1];
+                memcpy(&features[(size_t)count * SHAPE_FEATURE], &features[(size_t)(count - 1) * SHAPE_FEATURE], SHAPE_FEATURE);
+            }
+            shapes.count = count + count % 2;
+            shapes.features = features.data();
+            if (glyphShapesIndex(&shapes) != 0) return failures + 1;
+
+            matchShapesExhaustive(cells.data(), n, &shapes, expected.data());
+            for (int k = 0; k < 3; k++) {
+                if (kernels[k] == NULL) continue;
+                kernels[k](cells.data(), n, &shapes, dst.data());
+                if (dst != expected) {
+                    printf("Mismatch: shape kernel %s, glyph count %d\n", kernelNames[k], count);
+                    failures++;
+                }
+            }
+            free(shapes.sorted);
+        }
+    }
+    return failures;
+}
+
+// Feature vectors of every cell of text row i (cells holds SHAPE_FEATURE bytes per cell, subrow is scratch)
+static inline void shapeCellRow(const cv::Mat& src, const std::vector<int>& xSub, const std::vector<int>& ySub, int i, int cols,
+                                bool swapRB, unsigned long long* sums, unsigned char* subrow, unsigned char* cells) {
+    int n = cols * SHAPE_GRID;
+    for (int r = 0; r < SHAPE_GRID; r++) {
+        const int* y = &ySub[2 * (i * SHAPE_GRID + r)];
+        if (r == 0 || y[0] != y[-2] || y[1] != y[-1]) {  // Rows shorter than their subcells repeat the subrow
+            averageSubcellRow(src, xSub.data(), n, y[0], y[1], swapRB, sums, subrow);
+        }
+        for (int k = 0; k < n; k++) {
+            cells[(size_t)(k / SHAPE_GRID) * SHAPE_FEATURE + r * SHAPE_GRID + k % SHAPE_GRID] = subrow[k];
+        }
+    }
+}
+
+// Shape-matched text conversion: 4x4 subcell luma of every cell, nearest glyph straight into frame
+// (rows * (cols + 1) bytes, breaklines included), bands of rows spread over threads like averageToGlyphs()
+static inline void shapeToGlyphs(const cv::Mat& src, const std::vector<int>& xBounds, const std::vector<int>& yBounds, bool swapRB,
+                                 const GlyphShapes* shapes, char* frame, int threads, std::vector<WorkerLoad>* loads = NULL) {
+    int rows = (int)yBounds.size() - 1;
+    int cols = (int)xBounds.size() - 1;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    std::vector<int> xSub, ySub;
+    subcellBounds(xBounds, SHAPE_GRID, xSub);
+    subcellBounds(yBounds, SHAPE_GRID, ySub);
+
+    parallelForBands(bands, threads, [&](int band) {
+        std::vector<unsigned long long> sums(subcellScratchSize(src));
+        std::vector<unsigned char> subrow((size_t)cols * SHAPE_GRID);
+        std::vector<unsigned char> cells((size_t)cols * SHAPE_FEATURE);
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            shapeCellRow(src, xSub, ySub, i, cols, swapRB, sums.data(), subrow.data(), cells.data());
+            char* row = frame + (size_t)i * (cols + 1);
+            matchShapes(cells.data(), cols, shapes, row);
+            row[cols] = '\n';  // Breakline at the end of each row
+        }
+    }, loads);
+}
+
+#endif
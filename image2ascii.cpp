@@ -0,0 +1,730 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // For formatting the stats
+#include <string.h>             // For string manipulation
+#include <strings.h>            // For strcasecmp()
+#include <algorithm>            // For ordering the pyramid levels
+#include <thread>               // For writing the pyramid levels at once
+#include <sys/stat.h>           // For the size of written images
+#include <vector>               // For the ANSI band buffers and pyramid levels
+#include "image2ascii.h"        // For the library API
+#include "ascii_convert.h"      // For the resize, text and color conversion stages
+#include "ascii_output.h"       // For the row-buffered frame writer
+#include "ansi_color.h"         // For colored (ANSI escape) text output
+#include "ascii_decode.h"       // For decode-time reduction
+#include "cell_average.h"       // For the fused box-average kernels
+#include "glyph_shape.h"        // For shape-matched text
+#include "unicode_cells.h"      // For half-block and Braille text
+#include "dither.h"             // For dithered text
+#include "ascii_stats.h"        // For stage timers and worker loads
+#include "strip_encoder.h"      // For the threaded strip-wise PNG encoder
+#include "result_cache.h"       // For the content-addressed result cache
+#include "cell_file.h"          // For cell file output
+
+namespace ascii {
+
+Stats::Stats()
+    : startSeconds(monotonicSeconds()), wallSeconds(0.0), images(0), cells(0), bytesWritten(0), cacheHits(0), cacheMisses(0),
+      peakRSSKB(0) {
+    for (int s = 0; s < STAGE_COUNT; s++) stageSeconds[s] = 0.0;
+}
+
+// Warm state shared by every call of a Converter
+struct Converter::State {
+    Options options;
+    int threads;                                    // Resolved thread count (never 0)
+    unsigned char glyphLUT[GLYPH_LUT_SIZE];         // Intensity -> glyph
+    unsigned char ditherPattern[DITHER_PATTERN_SIZE]; // Ordered dither offsets (DITHER_ORDERED only)
+    GlyphAtlas atlas;                               // Glyph masks (MODE_COLOR_IMAGE only)
+    bool atlasReady;
+    GlyphShapes shapes;                             // Glyph coverage vectors (MODE_TEXT with MATCH_SHAPE only)
+    bool shapesReady;
+    unsigned char paletteTable[ANSI_PALETTE_SIZE];  // RGB555 -> 256-color index (MODE_ANSI_256 only)
+    unsigned char brailleTable[BRAILLE_TABLE_SIZE]; // Dot mask -> UTF-8 (MODE_BRAILLE only)
+};
+
+Converter::Converter(const Options& options) : state_(new State()) {
+    state_->options = options;
+    state_->threads = options.threads > 0 ? options.threads : defaultThreadCount();
+    buildGlyphLUT(options.asciiChars.c_str(), state_->glyphLUT);
+    buildOrderedDither(options.asciiChars.c_str(), state_->ditherPattern);
+
+    memset(&state_->atlas, 0, sizeof(state_->atlas));
+    state_->atlasReady = options.mode == MODE_COLOR_IMAGE && options.widthScale > 0 && options.heightScale > 0 &&
+                         glyphAtlasBuild(&state_->atlas, options.asciiChars.c_str(), options.widthScale, options.heightScale) == 0;
+    memset(&state_->shapes, 0, sizeof(state_->shapes));
+    state_->shapesReady = options.mode == MODE_TEXT && options.match == MATCH_SHAPE &&
+                          glyphShapesBuild(&state_->shapes, options.asciiChars.c_str()) == 0;
+    if (options.mode == MODE_ANSI_256) {
+        buildAnsi256Table(state_->paletteTable);
+    }
+    if (options.mode == MODE_BRAILLE) {
+        buildBrailleTable(state_->brailleTable);
+    }
+}
+
+Converter::~Converter() {
+    glyphAtlasFree(&state_->atlas);
+    glyphShapesFree(&state_->shapes);
+    delete state_;
+}
+
+const Options& Converter::options() const {
+    return state_->options;
+}
+
+Status Converter::gridSize(int width, int height, int* cols, int* rows) const {
+    if (state_->options.widthScale < 1 || state_->options.heightScale < 1) {
+        return ERROR_ARGUMENT;
+    }
+    *cols = width / state_->options.widthScale;   // Reduce width to adjust proportion
+    *rows = height / state_->options.heightScale; // Reduce height to adjust proportion
+    return (*cols < 1 || *rows < 1) ? ERROR_SIZE : OK;
+}
+
+Status Converter::gridSize(const ImageView& image, int* cols, int* rows) const {
+    return gridSize(image.sourceWidth > 0 ? image.sourceWidth : image.width,
+                    image.sourceHeight > 0 ? image.sourceHeight : image.height, cols, rows);
+}
+
+size_t Converter::maxTextSize(const ImageView& image) const {
+    return maxTextSize(image.sourceWidth > 0 ? image.sourceWidth : image.width,
+                       image.sourceHeight > 0 ? image.sourceHeight : image.height);
+}
+
+size_t Converter::maxTextSize(int width, int height) const {
+    int cols, rows;
+    if (gridSize(width, height, &cols, &rows) != OK) {
+        return 0;
+    }
+    switch (state_->options.mode) {
+        case MODE_TEXT:       return (size_t)rows * (size_t)(cols + 1);
+        case MODE_BRAILLE:    return (size_t)rows * ((size_t)cols * BRAILLE_CELL_BYTES + 1);
+        case MODE_HALF_BLOCK: return (size_t)rows * ((size_t)cols * HALF_BLOCK_MAX_CELL_BYTES + 5);
+        default:              break;
+    }
+    return (size_t)rows * ((size_t)cols * ANSI_MAX_CELL_BYTES + 5);
+}
+
+// Wraps the caller pixels in a cv::Mat header (no copy) and splits them in cells
+// Cell bounds follow the source size, so reduced pixels give the same grid as the full image
+static Status viewCells(const ImageView& view, const Options& options, cv::Mat& source, bool* swapRB,
+                        std::vector<int>& xBounds, std::vector<int>& yBounds) {
+    int type;
+    switch (view.format) {
+        case FORMAT_GRAY8:  type = CV_8UC1; break;
+        case FORMAT_BGR24:
+        case FORMAT_RGB24:  type = CV_8UC3; break;
+        case FORMAT_BGRA32:
+        case FORMAT_RGBA32: type = CV_8UC4; break;
+        default: return ERROR_ARGUMENT;
+    }
+    if (view.data == NULL || view.width < 1 || view.height < 1 || options.widthScale < 1 || options.heightScale < 1) {
+        return ERROR_ARGUMENT;
+    }
+    int sourceWidth = view.sourceWidth > 0 ? view.sourceWidth : view.width;
+    int sourceHeight = view.sourceHeight > 0 ? view.sourceHeight : view.height;
+    if (sourceWidth < view.width || sourceHeight < view.height) {
+        return ERROR_ARGUMENT;
+    }
+    int cols = sourceWidth / options.widthScale;   // Reduce width to adjust proportion
+    int rows = sourceHeight / options.heightScale; // Reduce height to adjust proportion
+    if (cols < 1 || rows < 1) {
+        return ERROR_SIZE;
+    }
+
+    source = cv::Mat(view.height, view.width, type, (void*)view.data, view.stride);  // stride 0 means packed rows
+    *swapRB = view.format == FORMAT_RGB24 || view.format == FORMAT_RGBA32;
+    cellBounds(cols, options.widthScale, view.width, sourceWidth, xBounds);
+    cellBounds(rows, options.heightScale, view.height, sourceHeight, yBounds);
+    return OK;
+}
+
+// Averages text rows [firstRow, firstRow + rowCount) of the caller pixels to one BGR pixel per character
+// rowCount < 0 takes every row
+static Status averageView(const ImageView& view, const Options& options, int threads, int firstRow, int rowCount, cv::Mat& cells) {
+    cv::Mat source;
+    bool swapRB;
+    std::vector<int> xBounds, yBounds;
+    Status status = viewCells(view, options, source, &swapRB, xBounds, yBounds);
+    if (status != OK) {
+        return status;
+    }
+    int rows = (int)yBounds.size() - 1;
+    if (rowCount < 0) {
+        rowCount = rows - firstRow;
+    }
+    if (firstRow < 0 || rowCount < 1 || firstRow + rowCount > rows) {
+        return ERROR_ARGUMENT;
+    }
+    std::vector<int> stripBounds(yBounds.begin() + firstRow, yBounds.begin() + firstRow + rowCount + 1);
+
+    std::vector<WorkerLoad> loads;
+    double start = stageStart(options.stats);
+    averageToCells(source, xBounds, stripBounds, swapRB, false, cells, threads, workerLoadsFor(options.stats, loads));
+    stageEnd(options.stats, STAGE_RESIZE, start);
+    addWorkerLoads(options.stats, loads);
+    return OK;
+}
+
+// Ends the convert or render stage of one image (or of a strip of it, images is 1 on the last strip only)
+static void finishConvert(Stats* stats, Stage stage, double start, int images, int cells, const std::vector<WorkerLoad>& loads) {
+    if (stats == NULL) return;
+    stageEnd(stats, stage, start);
+    addWorkerLoads(stats, loads);
+    stats->images += images;
+    stats->cells += cells;
+}
+
+// Copies the band buffers of a variable-size text mode in order into out, written gets the bytes used
+static Status stitchBands(const std::vector<std::vector<char>>& bandText, Span out, size_t* written) {
+    size_t size = 0;
+    for (size_t b = 0; b < bandText.size(); b++) size += bandText[b].size();
+    if (out.data == NULL || out.size < size) {
+        return ERROR_BUFFER;
+    }
+    size_t used = 0;
+    for (size_t b = 0; b < bandText.size(); b++) {
+        memcpy(out.data + used, bandText[b].data(), bandText[b].size());
+        used += bandText[b].size();
+    }
+    if (written != NULL) *written = size;
+    return OK;
+}
+
+Status Converter::convertText(const ImageView& image, Span out, size_t* written) const {
+    const Options& options = state_->options;
+    if (options.mode == MODE_COLOR_IMAGE) {
+        return ERROR_ARGUMENT;
+    }
+
+    Stats* stats = options.stats;
+    std::vector<WorkerLoad> loads;
+    if (options.mode == MODE_TEXT || options.mode == MODE_BRAILLE || options.mode == MODE_HALF_BLOCK) {
+        // Fused paths: cell (or subcell) average and glyph in one pass straight from the caller pixels
+        cv::Mat source;
+        bool swapRB;
+        std::vector<int> xBounds, yBounds;
+        Status status = viewCells(image, options, source, &swapRB, xBounds, yBounds);
+        if (status != OK) {
+            return status;
+        }
+        int cols = (int)xBounds.size() - 1;
+        int rows = (int)yBounds.size() - 1;
+        double start = stageStart(stats);
+        if (options.mode == MODE_HALF_BLOCK) {
+            // Half blocks: bands have variable sizes, they are stitched in order into the span
+            std::vector<std::vector<char>> bandText;
+            halfBlockToText(source, xBounds, yBounds, swapRB, state_->threads, bandText, workerLoadsFor(stats, loads));
+            status = stitchBands(bandText, out, written);
+            if (status != OK) {
+                return status;
+            }
+            finishConvert(stats, STAGE_CONVERT, start, 1, rows * cols, loads);
+            return OK;
+        }
+
+        size_t size = maxTextSize(image);  // Exact for plain text and Braille
+        if (out.data == NULL || out.size < size) {
+            return ERROR_BUFFER;
+        }
+        if (options.mode == MODE_BRAILLE) {
+            brailleToText(source, xBounds, yBounds, swapRB, state_->brailleTable, out.data, state_->threads,
+                          workerLoadsFor(stats, loads));
+        } else if (state_->shapesReady) {
+            shapeToGlyphs(source, xBounds, yBounds, swapRB, &state_->shapes, out.data, state_->threads, workerLoadsFor(stats, loads));
+        } else if (options.dither == DITHER_FLOYD_STEINBERG) {
+            // Error diffusion needs every cell intensity before the first glyph
+            cv::Mat cells;
+            averageToCells(source, xBounds, yBounds, swapRB, true, cells, state_->threads, workerLoadsFor(stats, loads));
+            floydSteinbergToGlyphs(cells.data, cells.step, rows, cols, options.asciiChars.c_str(), out.data, state_->threads,
+                                   workerLoadsFor(stats, loads));
+        } else {
+            averageToGlyphs(source, xBounds, yBounds, swapRB, state_->glyphLUT,
+                            options.dither == DITHER_ORDERED ? state_->ditherPattern : NULL, out.data, state_->threads,
+                            workerLoadsFor(stats, loads));
+        }
+        if (written != NULL) *written = size;
+        finishConvert(stats, STAGE_CONVERT, start, 1, rows * cols, loads);
+        return OK;
+    }
+
+    cv::Mat resized;
+    Status status = averageView(image, options, state_->threads, 0, -1, resized);
+    if (status != OK) {
+        return status;
+    }
+
+    double start = stageStart(stats);
+    try {
+        // ANSI: bands have variable sizes, they are stitched in order into the span
+        std::vector<std::vector<char>> bandText;
+        convertAnsiFrame(resized, state_->glyphLUT, state_->paletteTable,
+                         options.mode == MODE_ANSI_256 ? ANSI_MODE_256 : ANSI_MODE_TRUECOLOR, state_->threads, bandText,
+                         workerLoadsFor(stats, loads));
+        status = stitchBands(bandText, out, written);
+        if (status != OK) {
+            return status;
+        }
+        finishConvert(stats, STAGE_CONVERT, start, 1, resized.rows * resized.cols, loads);
+    } catch (const cv::Exception&) {
+        return ERROR_CONVERT;
+    }
+    return OK;
+}
+
+Status Converter::renderColor(const ImageView& image, ImageSpan out) const {
+    int cols, rows;
+    Status status = gridSize(image, &cols, &rows);
+    if (status != OK) {
+        return status;
+    }
+    return renderColorRows(image, 0, rows, out);
+}
+
+Status Converter::renderColorRows(const ImageView& image, int firstRow, int rowCount, ImageSpan out) const {
+    const Options& options = state_->options;
+    if (options.mode != MODE_COLOR_IMAGE) {
+        return ERROR_ARGUMENT;
+    }
+    if (!state_->atlasReady) {
+        return ERROR_CONVERT;
+    }
+
+    cv::Mat resized;
+    Status status = averageView(image, options, state_->threads, firstRow, rowCount, resized);
+    if (status != OK) {
+        return status;
+    }
+    if (out.data == NULL || out.width != resized.cols * options.widthScale || out.height != resized.rows * options.heightScale) {
+        return ERROR_BUFFER;
+    }
+
+    cv::Mat canvas(out.height, out.width, CV_8UC3, out.data, out.stride);  // Caller canvas, rendered in place
+    std::vector<WorkerLoad> loads;
+    double start = stageStart(options.stats);
+    try {
+        renderColorCanvas(resized, state_->glyphLUT, &state_->atlas, canvas, state_->threads, workerLoadsFor(options.stats, loads));
+    } catch (const cv::Exception&) {
+        return ERROR_CONVERT;
+    }
+    int rows, cols;
+    gridSize(image, &cols, &rows);
+    finishConvert(options.stats, STAGE_RENDER, start, firstRow + rowCount == rows ? 1 : 0, resized.rows * resized.cols, loads);
+    return OK;
+}
+
+Status Converter::convertCells(const ImageView& image, unsigned char* glyphs, size_t glyphStride, unsigned char* colors,
+                               size_t colorStride) const {
+    const Options& options = state_->options;
+    int cols, rows;
+    Status status = gridSize(image, &cols, &rows);
+    if (status != OK) {
+        return status;
+    }
+    if (options.asciiChars.size() > CELL_FILE_MAX_CHARSET || options.mode == MODE_HALF_BLOCK || options.mode == MODE_BRAILLE) {
+        return ERROR_ARGUMENT;  // Half blocks and braille dots are not charset glyphs, a cell file cannot hold them
+    }
+    if (glyphs == NULL || glyphStride < (size_t)cols || (colors != NULL && colorStride < (size_t)cols * 3)) {
+        return ERROR_BUFFER;
+    }
+
+    // Charset position of every glyph (the first one of repeated characters), an empty charset stores a space at 0
+    unsigned char position[256];
+    memset(position, 0, sizeof(position));
+    for (int k = (int)options.asciiChars.size() - 1; k >= 0; k--) {
+        position[(unsigned char)options.asciiChars[k]] = (unsigned char)k;
+    }
+
+    if (options.mode == MODE_TEXT) {
+        // Shape match and dither decide glyphs from more than the cell mean, so the text is converted and indexed
+        std::vector<char> frame((size_t)rows * (cols + 1));
+        Span span = {frame.data(), frame.size()};
+        status = convertText(image, span, NULL);
+        if (status != OK) {
+            return status;
+        }
+        for (int i = 0; i < rows; i++) {
+            const char* row = frame.data() + (size_t)i * (cols + 1);
+            unsigned char* dst = glyphs + (size_t)i * glyphStride;
+            for (int j = 0; j < cols; j++) dst[j] = position[(unsigned char)row[j]];
+        }
+        if (colors == NULL) {
+            return OK;
+        }
+    }
+
+    cv::Mat cells;
+    status = averageView(image, options, state_->threads, 0, -1, cells);
+    if (status != OK) {
+        return status;
+    }
+    double start = stageStart(options.stats);
+    for (int i = 0; i < rows; i++) {
+        const uchar* bgr = cells.ptr<uchar>(i);
+        if (colors != NULL) memcpy(colors + (size_t)i * colorStride, bgr, (size_t)cols * 3);
+        if (options.mode == MODE_TEXT) continue;
+        unsigned char* dst = glyphs + (size_t)i * glyphStride;
+        for (int j = 0; j < cols; j++) dst[j] = position[colorToGlyph(bgr + 3 * j, state_->glyphLUT)];
+    }
+    std::vector<WorkerLoad> loads;
+    bool counted = options.mode == MODE_TEXT;  // convertText() already counted the image
+    finishConvert(options.stats, STAGE_CONVERT, start, counted ? 0 : 1, counted ? 0 : rows * cols, loads);
+    return OK;
+}
+
+// True if path ends with .png (any case)
+static bool isPNGPath(const char* path) {
+    size_t length = strlen(path);
+    return length >= 4 && strcasecmp(path + length - 4, ".png") == 0;
+}
+
+// Colored image as PNG: a few text rows are rendered at a time while the encoder thread compresses the
+// previous ones, so rendering and compression overlap and only the strip ring is held, never the canvas
+static Status writeColorPNG(const Converter& converter, const ImageView& view, int cols, int rows, const char* outputPath) {
+    const Options& options = converter.options();
+    int threads = options.threads > 0 ? options.threads : defaultThreadCount();
+    int stripRows = threads < rows ? threads : rows;  // One text row per render thread
+    StripEncoder encoder;
+    if (encoder.open(outputPath, cols * options.widthScale, rows * options.heightScale, stripRows * options.heightScale) != 0) {
+        return ERROR_OUTPUT;
+    }
+
+    Status status = OK;
+    for (int first = 0; first < rows && status == OK; first += stripRows) {
+        int count = first + stripRows < rows ? stripRows : rows - first;
+        int buffer = encoder.acquire();
+        if (buffer < 0) {
+            status = ERROR_OUTPUT;
+            break;
+        }
+        ImageSpan strip = {encoder.data(buffer), cols * options.widthScale, count * options.heightScale, encoder.stride()};
+        status = converter.renderColorRows(view, first, count, strip);
+        if (status == OK) {
+            encoder.submit(buffer, strip.height);
+        }
+    }
+
+    if (status != OK) {
+        encoder.abort();
+    } else if (encoder.finish() != 0) {
+        status = ERROR_OUTPUT;
+    }
+    if (options.stats != NULL) {
+        options.stats->stageSeconds[STAGE_WRITE] += encoder.encodeSeconds();  // Overlapped with rendering
+    }
+    return status;
+}
+
+// Converts decoded pixels and writes them to outputPath in the format its extension and the mode ask for
+Status writeView(const Converter& converter, const ImageView& view, const char* outputPath) {
+    const Options& options = converter.options();
+    Stats* stats = options.stats;
+    double start;
+    int cols, rows;
+    Status status = converter.gridSize(view, &cols, &rows);
+    if (status != OK) {
+        return status;
+    }
+    int flags = (options.echo ? OUTPUT_ECHO_TERMINAL : 0) | (options.mmapOutput ? OUTPUT_MMAP_FILE : 0);
+    const char* textPath = outputPath;
+    if (isStdoutPath(outputPath)) {
+        textPath = NULL;  // Text to stdout is the terminal output, sent once
+        flags = OUTPUT_ECHO_TERMINAL;
+    }
+
+    if (isCellsPath(outputPath)) {
+        // The cell grid is small next to the pixels, it is held whole and sent with writev()
+        bool color = options.mode != MODE_TEXT;
+        std::vector<unsigned char> glyphs((size_t)rows * cols), colors(color ? (size_t)rows * cols * 3 : 0);
+        status = converter.convertCells(view, glyphs.data(), cols, color ? colors.data() : NULL, (size_t)cols * 3);
+        if (status != OK) {
+            return status;
+        }
+        start = stageStart(stats);
+        CellWriter writer;
+        if (cellWriterOpen(&writer, outputPath, cols, rows, options.widthScale, options.heightScale, options.asciiChars.c_str(),
+                           color) != 0 ||
+            cellWriterRows(&writer, glyphs.data(), cols, colors.data(), (size_t)cols * 3, rows) != 0 || cellWriterClose(&writer) != 0) {
+            if (writer.fd >= 0) close(writer.fd);
+            return ERROR_OUTPUT;
+        }
+        stageEnd(stats, STAGE_WRITE, start);
+        struct stat written;
+        if (stats != NULL && stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+        return OK;
+    }
+
+    // PNG unless the extension names another format cv::imwrite can encode (stdout and extensionless paths get PNG)
+    if (options.mode == MODE_COLOR_IMAGE && (isPNGPath(outputPath) || isStdoutPath(outputPath) || !cv::haveImageWriter(outputPath))) {
+        status = writeColorPNG(converter, view, cols, rows, outputPath);
+        struct stat written;
+        if (stats != NULL && status == OK && stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+        return status;
+    }
+    if (options.mode == MODE_COLOR_IMAGE) {
+        // Other formats (JPEG, WebP) are encoded by cv::imwrite from the whole canvas
+        cv::Mat output(rows * options.heightScale, cols * options.widthScale, CV_8UC3); // Canvas
+        ImageSpan canvas = {output.data, output.cols, output.rows, output.step};
+        status = converter.renderColor(view, canvas);
+        if (status != OK) {
+            return status;
+        }
+        // Save the rendered image
+        start = stageStart(stats);
+        if (!cv::imwrite(outputPath, output)) {
+            return ERROR_OUTPUT;
+        }
+        stageEnd(stats, STAGE_WRITE, start);
+        struct stat written;
+        if (stats != NULL && stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+        return OK;
+    }
+
+    if (options.mode == MODE_TEXT) {
+        // The frame is built straight in the writer buffer (or the mmap'd file)
+        FrameWriter writer;
+        if (frameWriterOpen(&writer, textPath, rows, cols, flags) != 0) {
+            return ERROR_OUTPUT;
+        }
+        Span frame = {writer.buffer, writer.size};
+        status = converter.convertText(view, frame, NULL);
+        start = stageStart(stats);
+        int flushStatus = (status == OK) ? frameWriterFlush(&writer) : 0;
+        if (frameWriterClose(&writer) != 0 || flushStatus != 0) {
+            return status != OK ? status : ERROR_OUTPUT;
+        }
+        stageEnd(stats, STAGE_WRITE, start);
+        if (stats != NULL && status == OK) stats->bytesWritten += (long long)frame.size;
+        return status;
+    }
+
+    // ANSI, half-block and Braille text: one write() for the file and one for the terminal
+    std::vector<char> text(converter.maxTextSize(view));
+    Span span = {text.data(), text.size()};
+    size_t written = 0;
+    status = converter.convertText(view, span, &written);
+    if (status != OK) {
+        return status;
+    }
+    struct iovec chunk = {text.data(), written};
+    start = stageStart(stats);
+    if (writeChunks(textPath, &chunk, 1, flags) != 0) {
+        return ERROR_OUTPUT;
+    }
+    stageEnd(stats, STAGE_WRITE, start);
+    if (stats != NULL) stats->bytesWritten += (long long)written;
+    return OK;
+}
+
+// convertFile() without the result cache
+static Status convertImageFile(const char* inputPath, const char* outputPath, const Options& options) {
+    if (options.maxMemory > 0) {
+        return streamFile(inputPath, outputPath, options);
+    }
+
+    // Loads the image already reduced when the format allows it (BGR, or gray for plain text)
+    Stats* stats = options.stats;
+    double start = stageStart(stats);
+    int sourceWidth, sourceHeight;
+    cv::Mat image = decodeForCells(inputPath, options, &sourceWidth, &sourceHeight);
+    if (image.empty()) {
+        return ERROR_LOAD;
+    }
+    stageEnd(stats, STAGE_DECODE, start);
+
+    Converter converter(options);
+    return writeView(converter, imageViewOfMat(image, sourceWidth, sourceHeight), outputPath);
+}
+
+Status convertFile(const char* inputPath, const char* outputPath, const Options& options) {
+    if (options.cacheDir.empty() || isStdoutPath(outputPath)) {
+        return convertImageFile(inputPath, outputPath, options);
+    }
+    Stats* stats = options.stats;
+    std::string key;
+    bool keyed = cacheKey(inputPath, outputPath, options, key) == 0;
+    double start = stageStart(stats);
+    if (keyed && cacheFetch(options.cacheDir.c_str(), key, outputPath, options.echo && options.mode != MODE_COLOR_IMAGE) == 0) {
+        stageEnd(stats, STAGE_WRITE, start);
+        if (stats != NULL) {
+            struct stat written;
+            stats->cacheHits++;
+            stats->images++;
+            if (stat(outputPath, &written) == 0) stats->bytesWritten += written.st_size;
+        }
+        return OK;
+    }
+    if (stats != NULL) stats->cacheMisses++;
+
+    Status status = convertImageFile(inputPath, outputPath, options);
+    if (status == OK && keyed) {
+        cacheStore(options.cacheDir.c_str(), key, outputPath, options.cacheLimit);  // A failed store only costs the next hit
+    }
+    return status;
+}
+
+Status convertEncoded(const unsigned char* data, size_t size, const char* outputPath, const Options& options) {
+    if (data == NULL || size == 0) {
+        return ERROR_LOAD;
+    }
+    Stats* stats = options.stats;
+    double start = stageStart(stats);
+    int sourceWidth, sourceHeight;
+    cv::Mat image = decodeBufferForCells(data, size, options, &sourceWidth, &sourceHeight);
+    if (image.empty()) {
+        return ERROR_LOAD;
+    }
+    stageEnd(stats, STAGE_DECODE, start);
+
+    Converter converter(options);
+    return writeView(converter, imageViewOfMat(image, sourceWidth, sourceHeight), outputPath);
+}
+
+// Options of every pyramid level (columns resolved against the source width)
+static Status pyramidOptions(const std::vector<PyramidLevel>& levels, const Options& options, int sourceWidth,
+                             std::vector<Options>& levelOptions) {
+    levelOptions.assign(levels.size(), options);
+    for (size_t k = 0; k < levels.size(); k++) {
+        Options& level = levelOptions[k];
+        if (levels[k].columns > 0) {
+            level.widthScale = sourceWidth / levels[k].columns;
+            level.heightScale = level.widthScale * options.heightScale / options.widthScale;
+            if (level.widthScale < 1 || level.heightScale < 1) {
+                return ERROR_SIZE;
+            }
+        } else {
+            level.widthScale = levels[k].widthScale;
+            level.heightScale = levels[k].heightScale;
+        }
+        if (level.widthScale < 1 || level.heightScale < 1) {
+            return ERROR_ARGUMENT;
+        }
+        level.echo = false;  // Levels are written at once, their text would interleave
+    }
+    return OK;
+}
+
+// Smallest reduction every level allows (the decode size)
+static int finestReduction(const std::vector<Options>& levelOptions, int limit) {
+    int reduction = limit;
+    for (size_t k = 0; k < levelOptions.size(); k++) {
+        int level = reductionForOptions(levelOptions[k], limit);
+        if (level < reduction) reduction = level;
+    }
+    return reduction;
+}
+
+Status convertPyramid(const char* inputPath, const std::vector<PyramidLevel>& levels, const Options& options) {
+    if (levels.empty() || options.widthScale < 1 || options.heightScale < 1) {
+        return ERROR_ARGUMENT;
+    }
+
+    // Decode once, as reduced as the finest level allows; column counts need the source width first,
+    // which only a JPEG header gives before decoding (other formats decode full size anyway)
+    Stats* stats = options.stats;
+    double start = stageStart(stats);
+    std::vector<Options> levelOptions;
+    int width, height;
+    int reduction = 1;
+    if (jpegImageSize(inputPath, &width, &height) == 0 && pyramidOptions(levels, options, width, levelOptions) == OK) {
+        reduction = finestReduction(levelOptions, 8);
+    }
+    int sourceWidth, sourceHeight;
+    cv::Mat image = decodeReduced(inputPath, &reduction, decodesGray(options), &sourceWidth, &sourceHeight);
+    if (image.empty()) {
+        return ERROR_LOAD;
+    }
+    Status status = pyramidOptions(levels, options, sourceWidth, levelOptions);
+    if (status != OK) {
+        return status;
+    }
+    if (reduction > finestReduction(levelOptions, 8)) {
+        // EXIF orientation swapped the axes the columns were counted on, the finest level needs more pixels
+        reduction = 1;
+        image = decodeReduced(inputPath, &reduction, decodesGray(options), &sourceWidth, &sourceHeight);
+        if (image.empty()) {
+            return ERROR_LOAD;
+        }
+    }
+    stageEnd(stats, STAGE_DECODE, start);
+
+    // Pyramid, finest level first: each level halves the image of the one before while its cells keep a pixel
+    std::vector<size_t> order(levels.size());
+    std::vector<int> levelReduction(levels.size());
+    for (size_t k = 0; k < levels.size(); k++) {
+        order[k] = k;
+        levelReduction[k] = reductionForOptions(levelOptions[k], 1 << 30);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return levelReduction[a] < levelReduction[b]; });
+    int threads = options.threads > 0 ? options.threads : defaultThreadCount();
+    std::vector<cv::Mat> levelImages(levels.size());
+    std::vector<WorkerLoad> loads;
+    start = stageStart(stats);
+    for (size_t n = 0; n < order.size(); n++) {
+        while (reduction * 2 <= levelReduction[order[n]] && image.cols > 1 && image.rows > 1) {
+            cv::Mat half;
+            halveImage(image, half, threads, workerLoadsFor(stats, loads));
+            image = half;
+            reduction *= 2;
+        }
+        levelImages[order[n]] = image;  // Shared with the next level until it halves
+    }
+    stageEnd(stats, STAGE_RESIZE, start);
+    addWorkerLoads(stats, loads);
+
+    // Every level converted and written at once, each on its share of the threads and with its own counters
+    std::vector<Stats> levelStats(levels.size());
+    std::vector<Status> results(levels.size(), OK);
+    std::vector<std::thread> writers;
+    for (size_t k = 0; k < levels.size(); k++) {
+        levelOptions[k].threads = threads / (int)levels.size() > 1 ? threads / (int)levels.size() : 1;
+        levelOptions[k].stats = stats != NULL ? &levelStats[k] : NULL;
+        writers.push_back(std::thread([&, k] {
+            Converter converter(levelOptions[k]);
+            results[k] = writeView(converter, imageViewOfMat(levelImages[k], sourceWidth, sourceHeight), levels[k].outputPath.c_str());
+        }));
+    }
+    for (size_t k = 0; k < writers.size(); k++) {
+        writers[k].join();
+        mergeStats(stats, levelStats[k]);
+        if (results[k] != OK && status == OK) status = results[k];
+    }
+    return status;
+}
+
+void finishStats(Stats& stats) {
+    stats.wallSeconds = monotonicSeconds() - stats.startSeconds;
+    stats.peakRSSKB = peakRSSKB();
+}
+
+std::string statsToJSON(const Stats& stats) {
+    static const char* stageNames[STAGE_COUNT] = {"decode", "resize", "convert", "render", "write"};
+    char field[160];
+    std::string json = "{\"stages_ms\": {";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        snprintf(field, sizeof(field), "%s\"%s\": %.3f", s > 0 ? ", " : "", stageNames[s], stats.stageSeconds[s] * 1000.0);
+        json += field;
+    }
+    snprintf(field, sizeof(field), "}, \"wall_ms\": %.3f, \"images\": %lld, \"cells\": %lld, \"cells_per_sec\": %.0f, ",
+             stats.wallSeconds * 1000.0, stats.images, stats.cells,
+             stats.wallSeconds > 0.0 ? (double)stats.cells / stats.wallSeconds : 0.0);
+    json += field;
+    snprintf(field, sizeof(field), "\"bytes_written\": %lld, \"cache_hits\": %lld, \"cache_misses\": %lld, ",
+             stats.bytesWritten, stats.cacheHits, stats.cacheMisses);
+    json += field;
+    snprintf(field, sizeof(field), "\"peak_rss_kb\": %ld, \"threads\": [", stats.peakRSSKB);
+    json += field;
+    for (size_t t = 0; t < stats.threads.size(); t++) {
+        snprintf(field, sizeof(field), "%s{\"bands\": %d, \"busy_ms\": %.3f}", t > 0 ? ", " : "",
+                 stats.threads[t].bands, stats.threads[t].busySeconds * 1000.0);
+        json += field;
+    }
+    json += "]}";
+    return json;
+}
+
+int selfTest() {
+    return glyphLUTSelfTest() + glyphShapesSelfTest() + brailleSelfTest() + ditherSelfTest();
+}
+
+}  // namespace ascii
@@ -0,0 +1,271 @@
+#ifndef IMAGE2ASCII_H
+#define IMAGE2ASCII_H
+
+#include <stddef.h>             // For size_t
+#include <string>               // For the charset and paths
+#include <vector>               // For batch input lists
+
+// * Default values
+#define DEFAULT_WIDTH_SCALE 10            // Width factor for scaling (characters are more long and taller)
+#define DEFAULT_HEIGHT_SCALE 10           // Height factor for scaling (characters are more long and taller)
+#define DEFAULT_ASCII_CHARS " .:-=+*#%@"  // Permited ASCII characters
+#define DEFAULT_CACHE_LIMIT (1ULL << 30)  // Result cache size before least recently used entries are evicted (1 GiB)
+
+// libimage2ascii: image to ASCII conversion shared by the command line front-ends and embedders
+// Pixels are read from caller-owned buffers and results are written into caller-provided spans (no copies, no temp files)
+namespace ascii {
+
+// Result of every call (0 on success, negative on error, like the command line exit codes)
+enum Status {
+    OK = 0,
+    ERROR_LOAD = -1,      // Input could not be read or decoded
+    ERROR_SIZE = -2,      // Image smaller than one character cell
+    ERROR_OUTPUT = -3,    // Output could not be created or written
+    ERROR_BUFFER = -4,    // Caller buffer too small
+    ERROR_ARGUMENT = -5,  // Invalid option, pixel format or mode for this call
+    ERROR_CONVERT = -6,   // OpenCV failed while converting
+    ERROR_MEMORY = -7,    // Image cannot be converted within Options::maxMemory
+    ERROR_NETWORK = -8    // Server socket could not be opened
+};
+
+// What a conversion produces
+enum Mode {
+    MODE_TEXT = 0,            // Plain text, cols + 1 bytes per row
+    MODE_COLOR_IMAGE = 1,     // Colored glyphs rendered on a BGR canvas
+    MODE_ANSI_TRUECOLOR = 2,  // Text with 24-bit ANSI color escapes
+    MODE_ANSI_256 = 3,        // Text with 256-color ANSI palette escapes
+    MODE_HALF_BLOCK = 4,      // U+2580 with 24-bit foreground (top half) and background (bottom half) colors
+    MODE_BRAILLE = 5          // U+2800 - U+28FF, 2x4 thresholded dots per cell (UTF-8, 3 bytes per cell)
+};
+
+// How MODE_TEXT picks the glyph of a cell
+enum GlyphMatch {
+    MATCH_BRIGHTNESS = 0,     // Mean intensity of the cell indexes the charset (darkest first)
+    MATCH_SHAPE = 1           // 4x4 subcell intensities are matched against the rasterized glyphs (edges follow the image)
+};
+
+// How MODE_TEXT spreads the rounding of intensities to glyphs (smooth gradients with short charsets)
+enum Dither {
+    DITHER_NONE = 0,
+    DITHER_ORDERED = 1,          // 4x4 Bayer thresholds, every cell on its own
+    DITHER_FLOYD_STEINBERG = 2   // Error diffusion, rows on a parallel wavefront (same text on any thread count)
+};
+
+// Layout of the caller pixels (8 bits per channel)
+enum PixelFormat {
+    FORMAT_GRAY8,
+    FORMAT_BGR24,
+    FORMAT_RGB24,
+    FORMAT_BGRA32,
+    FORMAT_RGBA32
+};
+
+// Stages timed by Stats
+enum Stage {
+    STAGE_DECODE = 0,   // cv::imread
+    STAGE_RESIZE,       // Resize to one pixel per character
+    STAGE_CONVERT,      // Grayscale and glyph mapping (plain or ANSI text)
+    STAGE_RENDER,       // Glyphs drawn on the colored canvas
+    STAGE_WRITE,        // File and terminal output
+    STAGE_COUNT
+};
+
+// Bands run and time spent in them by one worker thread
+struct ThreadStats {
+    int bands;
+    double busySeconds;
+};
+
+// Counters filled by the calls that get it through Options::stats (nothing is measured without it)
+// Stages add up over every call, so a batch reports its totals; finishStats() sets wall time and peak RSS
+struct Stats {
+    double startSeconds;                  // Monotonic time at construction
+    double wallSeconds;
+    double stageSeconds[STAGE_COUNT];
+    long long images;
+    long long cells;
+    long long bytesWritten;
+    long long cacheHits;                  // Outputs copied from Options::cacheDir without decoding
+    long long cacheMisses;
+    long peakRSSKB;
+    std::vector<ThreadStats> threads;     // Indexed by worker, worker 0 is the calling thread
+
+    Stats();
+};
+
+// Conversion settings
+struct Options {
+    int widthScale;          // Source pixels per character, horizontally
+    int heightScale;         // Source pixels per character, vertically
+    std::string asciiChars;  // Charset, darkest first
+    Mode mode;
+    GlyphMatch match;        // MODE_TEXT only, the other modes always match brightness
+    Dither dither;           // MODE_TEXT with MATCH_BRIGHTNESS only
+    int threads;             // 0 uses every core
+    bool echo;               // convertFile(): also send text to the terminal
+    bool mmapOutput;         // convertFile(): write text through an mmap'd region
+    Stats* stats;            // Stage timings and counters, NULL to measure nothing
+    size_t maxMemory;        // convertFile(): bytes of pixel and output buffers, 0 for no limit (whole image in memory)
+    std::string cacheDir;    // convertFile() / runBatch(): result cache directory, empty for no cache
+    unsigned long long cacheLimit;  // Bytes the result cache may hold
+
+    Options()
+        : widthScale(DEFAULT_WIDTH_SCALE), heightScale(DEFAULT_HEIGHT_SCALE), asciiChars(DEFAULT_ASCII_CHARS),
+          mode(MODE_TEXT), match(MATCH_BRIGHTNESS), dither(DITHER_NONE), threads(0), echo(true), mmapOutput(false), stats(NULL), maxMemory(0),
+          cacheLimit(DEFAULT_CACHE_LIMIT) {}
+};
+
+// Caller-owned pixels, read in place
+// Pixels decoded smaller than the source (e.g. cv::IMREAD_REDUCED_*) give the source size, so the
+// character grid stays the one of the full image and each cell averages the pixels it covers
+struct ImageView {
+    const unsigned char* data;
+    int width;
+    int height;
+    size_t stride;           // Bytes between two rows
+    PixelFormat format;
+    int sourceWidth;         // Size of the full image, 0 when the pixels are full size
+    int sourceHeight;
+
+    ImageView() : data(NULL), width(0), height(0), stride(0), format(FORMAT_BGR24), sourceWidth(0), sourceHeight(0) {}
+};
+
+// Caller-provided text output
+struct Span {
+    char* data;
+    size_t size;
+};
+
+// Caller-provided BGR24 canvas output (cols * widthScale x rows * heightScale pixels)
+struct ImageSpan {
+    unsigned char* data;
+    int width;
+    int height;
+    size_t stride;           // Bytes between two rows
+};
+
+// Converter with warm state: glyph table, glyph atlas and palette table are built once in the constructor
+// and reused by every call; const calls can run from several threads at once (without Options::stats)
+// Cells are the integer box average of the pixels they cover, computed in one pass without resized copies
+class Converter {
+public:
+    explicit Converter(const Options& options);
+    ~Converter();
+
+    const Options& options() const;
+
+    // Character grid of a width x height image (or of the source size of a view)
+    Status gridSize(int width, int height, int* cols, int* rows) const;
+    Status gridSize(const ImageView& image, int* cols, int* rows) const;
+
+    // Bytes convertText() may need (exact for MODE_TEXT and MODE_BRAILLE, an upper bound for the colored modes)
+    size_t maxTextSize(int width, int height) const;
+    size_t maxTextSize(const ImageView& image) const;
+
+    // Every mode but MODE_COLOR_IMAGE: writes the text into out, written gets the bytes used
+    Status convertText(const ImageView& image, Span out, size_t* written) const;
+
+    // MODE_COLOR_IMAGE: renders the colored canvas into out (size must match gridSize() * scales)
+    Status renderColor(const ImageView& image, ImageSpan out) const;
+
+    // MODE_COLOR_IMAGE: renders only text rows [firstRow, firstRow + rowCount) into out (rowCount * heightScale pixels tall),
+    // so a canvas can be rendered and encoded strip by strip instead of held whole
+    Status renderColorRows(const ImageView& image, int firstRow, int rowCount, ImageSpan out) const;
+
+    // Any mode but MODE_HALF_BLOCK and MODE_BRAILLE (ERROR_ARGUMENT): the cell grid as charset positions (glyphs, cols bytes per row) and, unless colors is NULL, the mean
+    // BGR color of every cell (cols * 3 bytes per row), the content of a cell file (cell_file.h)
+    // MODE_TEXT glyphs follow Options::match and Options::dither, the other modes pick glyphs by brightness
+    Status convertCells(const ImageView& image, unsigned char* glyphs, size_t glyphStride, unsigned char* colors,
+                        size_t colorStride) const;
+
+private:
+    struct State;
+    State* state_;
+    Converter(const Converter&);             // Not copyable
+    Converter& operator=(const Converter&);
+};
+
+// Converts one image file: text (file + terminal), ANSI text or a colored image
+// An output path ending in .cells gets a cell file instead (glyphs, plus colors in every mode but MODE_TEXT), except
+// in MODE_HALF_BLOCK and MODE_BRAILLE, whose cells are not charset glyphs (ERROR_ARGUMENT)
+// and "-" writes to stdout (text once, colored images as PNG)
+// Colored PNGs are rendered and encoded strip by strip on two threads, other extensions cv::imwrite can encode
+// go through it, paths without one get PNG
+// With Options::maxMemory, PNG and JPEG inputs are streamed instead (see streamFile())
+// With Options::cacheDir, an input already converted with the same options is copied from the cache without decoding
+Status convertFile(const char* inputPath, const char* outputPath, const Options& options);
+
+// convertFile() for encoded image bytes held in memory (e.g. read from stdin), decoded with cv::imdecode
+// Options::maxMemory and Options::cacheDir do not apply
+Status convertEncoded(const unsigned char* data, size_t size, const char* outputPath, const Options& options);
+
+// Converts a PNG or JPEG a strip of text rows at a time: rows are decoded, converted and flushed as they arrive,
+// so peak memory follows the strip, never the image (gigapixel inputs), and stays within Options::maxMemory
+// Colored images are always written as PNG and cell files row by row; returns ERROR_MEMORY for other formats or a budget below one text row
+// Dithered text (Options::dither) is ERROR_ARGUMENT: strips convert apart, so the dither would restart at every strip
+Status streamFile(const char* inputPath, const char* outputPath, const Options& options);
+
+// One output of convertPyramid(): its cell size, given directly or as a column count, and where it is written
+struct PyramidLevel {
+    int columns;             // Characters per row, 0 to use the scales; the height scale keeps the aspect of Options
+    int widthScale;
+    int heightScale;
+    std::string outputPath;  // Same formats as convertFile(), .cells included
+
+    PyramidLevel() : columns(0), widthScale(DEFAULT_WIDTH_SCALE), heightScale(DEFAULT_HEIGHT_SCALE) {}
+};
+
+// Converts one image file at several cell sizes with a single decode: the image is decoded as small as the finest
+// level allows and every coarser level is box-averaged from the one before it (2x2 halvings), never from the source,
+// then every level is converted and written at once on its own share of the threads
+// Text is not echoed; Options::maxMemory and Options::cacheDir do not apply
+Status convertPyramid(const char* inputPath, const std::vector<PyramidLevel>& levels, const Options& options);
+
+// Called once per batch input, in input order
+typedef void (*BatchReport)(const char* inputPath, const char* outputPath, Status status);
+
+// Fills inputs from a directory (every readable image inside), a glob pattern or a newline-delimited list file
+Status collectBatchInputs(const char* spec, std::vector<std::string>& inputs);
+
+// Converts every input into outputDir with pipelined decode -> convert -> write stages (cached inputs skip them all)
+// Failing inputs are reported and skipped, returns the number of failed inputs
+// With Options::maxMemory, inputs are streamed one at a time instead (see streamFile(), ERROR_MEMORY when one cannot be)
+int runBatch(const std::vector<std::string>& inputs, const Options& options, const char* outputDir, BatchReport report);
+
+// Plays a video file, /dev/video* device or camera index as text in the terminal (MODE_TEXT only, ERROR_ARGUMENT otherwise)
+// Ctrl+C, SIGTERM and SIGHUP stop it with the terminal restored, Ctrl+Z suspends it and it redraws when continued
+// statsFormat is the printf format of the stats line: fps (double), bytes/frame (int), dropped (int)
+Status playVideo(const char* source, const Options& options, const char* statsFormat);
+
+// Interactive viewer of one image file in the terminal (stdin and stdout must be terminals, ERROR_ARGUMENT otherwise)
+// Arrows or h/j/k/l pan, + and - zoom, 0 fits the whole image, q or Esc quits; the view follows terminal resizes
+// The terminal is restored on SIGINT, SIGTERM and SIGHUP, and while Ctrl+Z keeps the viewer stopped
+// Frames only convert the cells that were not visible before at that zoom (tiles from a pyramid of the image),
+// glyphs follow brightness; MODE_TEXT and MODE_BRAILLE show plain text, the other modes ANSI colored text
+// statusFormat is the printf format of the status line: x, y, cell width, cell height, pyramid level (int),
+// tiles converted, tiles reused (int), frame time in ms (double)
+Status viewImage(const char* inputPath, const Options& options, const char* statusFormat);
+
+// Conversion daemon: serves requests (image bytes + mode, scales and charset) on address, a Unix socket path,
+// "PORT" or "HOST:PORT" (TCP, localhost unless HOST is given), and answers text, ANSI text or PNG bytes
+// Converters stay warm between requests; workers requests are converted at once (0 for every core) and up to
+// queueDepth more wait for a worker before new clients wait in the listen backlog. Idle keep-alive connections hold
+// no worker and are closed after a minute without a request. Runs until SIGINT or SIGTERM
+// options gives the defaults of requests without scales or charset (wire format in serve_protocol.h)
+// Requests may send up to maxImage image bytes (0 for SERVE_MAX_IMAGE, 256 MiB); bytes are buffered as they arrive
+// and a worker frees buffers a large request grew, so memory follows the images actually sent
+Status serve(const char* address, const Options& options, int workers, int queueDepth, unsigned long long maxImage);
+
+// Sets the wall time since the Stats was built and the peak resident memory of the process
+void finishStats(Stats& stats);
+
+// Stats as one JSON object (stage times in milliseconds)
+std::string statsToJSON(const Stats& stats);
+
+// Checks the glyph table, shape match, Braille and dither kernels against the reference ones (and Floyd-Steinberg
+// on several thread counts), returns the number of mismatches
+int selfTest();
+
+}  // namespace ascii
+
+#endif
@@ -0,0 +1,441 @@
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <unistd.h>             // For removing the temporary files
+#include <algorithm>            // For the median
+#include <chrono>               // For the stage timers
+#include <string>               // For paths and JSON records
+#include <vector>               // For the timings and the result list
+#include "image2ascii.h"        // For the defaults and the corpus listing
+#include "ascii_convert.h"      // For imageViewOfMat()
+#include "ascii_output.h"       // For writeFileAll()
+#include "cell_average.h"       // For the fused box-average kernels
+#include "dither.h"             // For dithered text
+#include "glyph_shape.h"        // For shape-matched text
+#include "strip_encoder.h"      // For the threaded strip-wise PNG encoder
+
+// * Default values
+#define BENCH_DEFAULT_SIZES   "256,1024,4096,16384"  // Side of the generated square images
+#define BENCH_DEFAULT_SCALES  "2,4,10,20"            // Pixels per character (width and height)
+#define BENCH_DEFAULT_REPEAT  5                      // Runs per stage, the median is reported
+#define BENCH_LONG_CHARSET    " .'`^\",:;Il!i><~+_-?][}{1)(|\\/tjfrxnuvczXYUJCLQ0OZmwqpdbkhao*#MW&8%B@$"
+
+// Charsets timed for every image and scale (short, default and long)
+static const char* benchCharsets[] = {" @", DEFAULT_ASCII_CHARS, BENCH_LONG_CHARSET};
+static const int benchCharsetCount = 3;
+
+// Command line settings
+struct BenchSettings {
+    std::vector<int> sizes;
+    std::vector<int> scales;
+    int repeat;
+    int threads;
+    const char* corpus;  // Directory of real images, NULL for generated images only
+    const char* output;  // JSON file, NULL for stdout
+};
+
+// Timings of one stage over every run
+struct BenchTiming {
+    double medianMs;
+    double minMs;
+    double maxMs;
+};
+
+// One JSON object of the "results" array
+struct BenchResult {
+    std::string image;
+    int width;
+    int height;
+    const char* stage;
+    int scale;          // 0 when the stage does not depend on it
+    int charsetLength;  // 0 when the stage does not depend on it
+    double work;        // Pixels, cells or bytes handled by one run
+    const char* unit;
+    BenchTiming timing;
+    double ratio;       // Median against the median of the stage it replaces (text_fused), 0 when none
+};
+
+// Runs work repeat times and keeps the median, min and max wall time
+template <typename Work>
+static BenchTiming timeStage(int repeat, Work work) {
+    std::vector<double> runs;
+    for (int r = 0; r < repeat; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        work();
+        runs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(runs.begin(), runs.end());
+    BenchTiming timing = {runs[runs.size() / 2], runs.front(), runs.back()};
+    return timing;
+}
+
+// Parses a comma separated list of positive integers, returns -1 if one is not valid
+static int parseIntList(const char* text, std::vector<int>& values) {
+    values.clear();
+    while (*text != '\0') {
+        char* end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value < 1 || value > 65536 || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        values.push_back((int)value);
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return values.empty() ? -1 : 0;
+}
+
+// Fills a deterministic test image: gradients (smooth areas), a xor pattern (edges) and hashed noise (texture)
+static void fillSynthetic(cv::Mat& image, int threads) {
+    int rows = image.rows;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    parallelForBands(bands, threads, [&](int band) {
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            unsigned char* row = image.ptr<uchar>(i);
+            for (int j = 0; j < image.cols; j++) {
+                unsigned int hash = (unsigned int)(i * 73856093) ^ (unsigned int)(j * 19349663);
+                hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+                row[3 * j] = (unsigned char)((size_t)j * 255 / image.cols);
+                row[3 * j + 1] = (unsigned char)((size_t)i * 255 / rows);
+                row[3 * j + 2] = (unsigned char)((((i >> 4) ^ (j >> 4)) & 1) * 160 + ((hash >> 24) & 63));
+            }
+        }
+    });
+}
+
+// Writes s as a JSON string literal
+static void printJSONString(FILE* out, const std::string& s) {
+    fputc('"', out);
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Writes the whole run as one JSON document (stable key order, so two runs can be diffed)
+static void printJSON(FILE* out, const BenchSettings& settings, const std::vector<BenchResult>& results) {
+    bool sse41 = false, avx2 = false;
+#ifdef ASCII_LUT_X86
+    __builtin_cpu_init();
+    sse41 = __builtin_cpu_supports("sse4.1");
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+    fprintf(out, "{\n  \"benchmark\": \"image2ascii\",\n");
+    fprintf(out, "  \"threads\": %d,\n  \"repeat\": %d,\n", settings.threads, settings.repeat);
+    fprintf(out, "  \"cpu\": {\"sse4_1\": %s, \"avx2\": %s},\n", sse41 ? "true" : "false", avx2 ? "true" : "false");
+    fprintf(out, "  \"results\": [\n");
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult& result = results[r];
+        fprintf(out, "    {\"image\": ");
+        printJSONString(out, result.image);
+        fprintf(out, ", \"width\": %d, \"height\": %d, \"stage\": \"%s\", \"scale\": %d, \"charset_length\": %d, ",
+                result.width, result.height, result.stage, result.scale, result.charsetLength);
+        fprintf(out, "\"work\": %.0f, \"unit\": \"%s\", \"median_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, ",
+                result.work, result.unit, result.timing.medianMs, result.timing.minMs, result.timing.maxMs);
+        fprintf(out, "\"per_second\": %.0f, \"ratio\": %.3f}%s\n",
+                result.timing.medianMs > 0.0 ? result.work * 1000.0 / result.timing.medianMs : 0.0, result.ratio,
+                r + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// Writes the canvas as a PNG through the strip encoder, stripRows pixel rows at a time
+static void writeCanvasPNG(const char* path, const cv::Mat& canvas, int stripRows) {
+    StripEncoder encoder;
+    if (encoder.open(path, canvas.cols, canvas.rows, stripRows) != 0) {
+        return;
+    }
+    for (int first = 0; first < canvas.rows; first += stripRows) {
+        int count = first + stripRows < canvas.rows ? stripRows : canvas.rows - first;
+        int buffer = encoder.acquire();
+        if (buffer < 0) {
+            encoder.abort();
+            return;
+        }
+        for (int y = 0; y < count; y++) {
+            memcpy(encoder.data(buffer) + (size_t)y * encoder.stride(), canvas.ptr<uchar>(first + y), encoder.stride());
+        }
+        encoder.submit(buffer, count);
+    }
+    encoder.finish();
+}
+
+// Times every stage of one decoded image (decode itself is timed by the caller)
+static void benchImage(const std::string& name, const cv::Mat& image, const BenchSettings& settings,
+                       const std::string& tempDir, std::vector<BenchResult>& results) {
+    int threads = settings.threads;
+    for (size_t s = 0; s < settings.scales.size(); s++) {
+        int scale = settings.scales[s];
+        if (image.cols / scale < 1 || image.rows / scale < 1) continue;
+        fprintf(stderr, "%s %dx%d scale %d\n", name.c_str(), image.cols, image.rows, scale);
+
+        int cols = image.cols / scale, rows = image.rows / scale;
+        double cells = (double)cols * rows;
+
+        // Integer box average to one pixel per cell (the converter's cell averaging, colored modes average like this)
+        std::vector<int> xBounds, yBounds;
+        cellBounds(cols, scale, image.cols, image.cols, xBounds);
+        cellBounds(rows, scale, image.rows, image.rows, yBounds);
+        cv::Mat averaged;
+        BenchResult result = {name, image.cols, image.rows, "cell_average", scale, 0,
+                              (double)image.cols * image.rows, "pixels", BenchTiming(), 0.0};
+        result.timing = timeStage(settings.repeat, [&] { averageToCells(image, xBounds, yBounds, false, false, averaged, threads); });
+        results.push_back(result);
+
+        cv::Mat gray;
+        result.stage = "grayscale";
+        result.work = cells;
+        result.unit = "cells";
+        result.timing = timeStage(settings.repeat, [&] { cv::cvtColor(averaged, gray, cv::COLOR_BGR2GRAY); });
+        results.push_back(result);
+
+        std::vector<char> frame((size_t)rows * (cols + 1));
+        cv::Mat canvas(rows * scale, cols * scale, CV_8UC3);
+        ascii::ImageSpan canvasSpan = {canvas.data, canvas.cols, canvas.rows, canvas.step};
+        ascii::ImageView view = imageViewOfMat(image);
+        for (int c = 0; c < benchCharsetCount; c++) {
+            const char* asciiChars = benchCharsets[c];
+            unsigned char glyphLUT[GLYPH_LUT_SIZE];
+            buildGlyphLUT(asciiChars, glyphLUT);
+            result.charsetLength = (int)strlen(asciiChars);
+
+            // Glyph mapping alone (serial kernel over the gray image)
+            result.stage = "glyph_map";
+            result.work = cells;
+            result.unit = "cells";
+            result.timing = timeStage(settings.repeat, [&] {
+                for (int i = 0; i < gray.rows; i++) {
+                    mapRowToASCII(gray.ptr<uchar>(i), &frame[(size_t)i * (gray.cols + 1)], gray.cols, glyphLUT);
+                }
+            });
+            results.push_back(result);
+
+            // Fused average, intensity and glyph from the full image (the converter's text path)
+            result.stage = "text_fused";
+            result.work = (double)image.cols * image.rows;
+            result.unit = "pixels";
+            result.timing = timeStage(settings.repeat, [&] {
+                averageToGlyphs(image, xBounds, yBounds, false, glyphLUT, NULL, frame.data(), threads);
+            });
+            results.push_back(result);
+            double fusedMs = result.timing.medianMs;  // Baseline of the dithered and shape-matched variants
+
+            // Dithered variants of text_fused: ordered offsets in the same pass, Floyd-Steinberg on the cell intensities
+            unsigned char ditherPattern[DITHER_PATTERN_SIZE];
+            buildOrderedDither(asciiChars, ditherPattern);
+            result.stage = "text_ordered";
+            result.timing = timeStage(settings.repeat, [&] {
+                averageToGlyphs(image, xBounds, yBounds, false, glyphLUT, ditherPattern, frame.data(), threads);
+            });
+            result.ratio = fusedMs > 0.0 ? result.timing.medianMs / fusedMs : 0.0;
+            results.push_back(result);
+
+            cv::Mat cellGray;
+            result.stage = "text_floyd";
+            result.timing = timeStage(settings.repeat, [&] {
+                averageToCells(image, xBounds, yBounds, false, true, cellGray, threads);
+                floydSteinbergToGlyphs(cellGray.data, cellGray.step, cellGray.rows, cellGray.cols, asciiChars, frame.data(), threads);
+            });
+            result.ratio = fusedMs > 0.0 ? result.timing.medianMs / fusedMs : 0.0;
+            results.push_back(result);
+            result.ratio = 0.0;
+
+            GlyphShapes shapes;
+            memset(&shapes, 0, sizeof(shapes));
+            result.stage = "shape_build";
+            result.work = (double)result.charsetLength;
+            result.unit = "glyphs";
+            result.timing = timeStage(settings.repeat, [&] {
+                glyphShapesFree(&shapes);
+                glyphShapesBuild(&shapes, asciiChars);
+            });
+            results.push_back(result);
+
+            // Shape matching from the full image (4x4 subcells per cell, nearest glyph), its ratio is the cost of --shape
+            // over the brightness text of text_fused
+            result.stage = "text_shape";
+            result.work = (double)image.cols * image.rows;
+            result.unit = "pixels";
+            result.timing = timeStage(settings.repeat, [&] {
+                shapeToGlyphs(image, xBounds, yBounds, false, &shapes, frame.data(), threads);
+            });
+            result.ratio = fusedMs > 0.0 ? result.timing.medianMs / fusedMs : 0.0;
+            results.push_back(result);
+            result.ratio = 0.0;
+            glyphShapesFree(&shapes);
+
+            std::string textPath = tempDir + "/output.txt";
+            result.stage = "write_text";
+            result.work = (double)frame.size();
+            result.unit = "bytes";
+            result.timing = timeStage(settings.repeat, [&] { writeFileAll(textPath.c_str(), frame.data(), frame.size()); });
+            results.push_back(result);
+            unlink(textPath.c_str());
+
+            GlyphAtlas atlas;
+            memset(&atlas, 0, sizeof(atlas));
+            result.stage = "atlas_build";
+            result.work = (double)result.charsetLength;
+            result.unit = "glyphs";
+            result.timing = timeStage(settings.repeat, [&] {
+                glyphAtlasFree(&atlas);
+                glyphAtlasBuild(&atlas, asciiChars, scale, scale);
+            });
+            results.push_back(result);
+
+            glyphAtlasFree(&atlas);
+
+            // Colored canvas through the converter (cell average and tinted glyphs, renderColorRows() of every row)
+            ascii::Options colorOptions;
+            colorOptions.mode = ascii::MODE_COLOR_IMAGE;
+            colorOptions.asciiChars = asciiChars;
+            colorOptions.widthScale = scale;
+            colorOptions.heightScale = scale;
+            colorOptions.threads = threads;
+            ascii::Converter converter(colorOptions);
+            result.stage = "color_render";
+            result.work = cells;
+            result.unit = "cells";
+            result.timing = timeStage(settings.repeat, [&] { converter.renderColor(view, canvasSpan); });
+            results.push_back(result);
+
+            // PNG encoding as colored output runs it (strips of one text row per thread on the encoder thread)
+            // Only the encoder is timed, in the converter it overlaps with rendering the next strip
+            std::string pngPath = tempDir + "/output.png";
+            result.stage = "write_png";
+            result.work = (double)canvas.cols * canvas.rows;
+            result.unit = "pixels";
+            int stripRows = (threads < rows ? threads : rows) * scale;
+            result.timing = timeStage(settings.repeat, [&] { writeCanvasPNG(pngPath.c_str(), canvas, stripRows); });
+            results.push_back(result);
+            unlink(pngPath.c_str());
+        }
+    }
+}
+
+// Times decode (cv::imread) of path and every later stage of the decoded image
+static void benchFile(const std::string& name, const std::string& path, const BenchSettings& settings,
+                      const std::string& tempDir, std::vector<BenchResult>& results) {
+    cv::Mat image;
+    cv::setNumThreads(settings.threads);
+    BenchTiming timing = timeStage(settings.repeat, [&] { image = cv::imread(path, cv::IMREAD_COLOR); });
+    cv::setNumThreads(1);
+    if (image.empty()) {
+        fprintf(stderr, "Error loading the image: %s\n", path.c_str());
+        return;
+    }
+    BenchResult result = {name, image.cols, image.rows, "decode", 0, 0, (double)image.cols * image.rows, "pixels", timing, 0.0};
+    results.push_back(result);
+    benchImage(name, image, settings, tempDir, results);
+}
+
+static void benchUsage(const char* programName) {
+    printf("Usage: %s [options]\n", programName);
+    printf("\nTimes every conversion stage and prints the results as JSON: decode, cell_average, grayscale, glyph_map,\n");
+    printf("text_fused, text_ordered, text_floyd, shape_build, text_shape, write_text, atlas_build, color_render and write_png.\n");
+    printf("text_ordered, text_floyd and text_shape also give their ratio to text_fused.\n");
+    printf("\nOptions:\n");
+    printf("  --sizes LIST       Sides of the generated square images (default: %s).\n", BENCH_DEFAULT_SIZES);
+    printf("  --scales LIST      Pixels per character (default: %s).\n", BENCH_DEFAULT_SCALES);
+    printf("  --repeat N         Runs per stage, the median is reported (default: %d).\n", BENCH_DEFAULT_REPEAT);
+    printf("  --threads N        Number of conversion threads (default: every core).\n");
+    printf("  --corpus DIR       Also times every image of DIR.\n");
+    printf("  --output FILE      Writes the JSON to FILE instead of stdout.\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchSettings settings;
+    parseIntList(BENCH_DEFAULT_SIZES, settings.sizes);
+    parseIntList(BENCH_DEFAULT_SCALES, settings.scales);
+    settings.repeat = BENCH_DEFAULT_REPEAT;
+    settings.threads = defaultThreadCount();
+    settings.corpus = NULL;
+    settings.output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+            if (parseIntList(argv[++i], settings.sizes) != 0) {
+                fprintf(stderr, "Invalid size list: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scales") == 0 && hasValue) {
+            if (parseIntList(argv[++i], settings.scales) != 0) {
+                fprintf(stderr, "Invalid scale list: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            settings.repeat = atoi(argv[++i]);
+            if (settings.repeat < 1) settings.repeat = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            settings.threads = atoi(argv[++i]);
+            if (settings.threads < 1) settings.threads = defaultThreadCount();
+        } else if (strcmp(argv[i], "--corpus") == 0 && hasValue) {
+            settings.corpus = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            settings.output = argv[++i];
+        } else {
+            benchUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    char tempTemplate[] = "/tmp/image2ascii_bench.XXXXXX";
+    if (mkdtemp(tempTemplate) == NULL) {
+        fprintf(stderr, "Error creating the temporary directory.\n");
+        return 1;
+    }
+    std::string tempDir = tempTemplate;
+    cv::setNumThreads(1);  // Stages that use OpenCV threads enable them around their own calls
+    std::vector<BenchResult> results;
+
+    // Generated images: encoded once as PNG so decode is timed like a real input
+    for (size_t s = 0; s < settings.sizes.size(); s++) {
+        int side = settings.sizes[s];
+        std::string path = tempDir + "/synthetic.png";
+        {
+            cv::Mat image(side, side, CV_8UC3);
+            fillSynthetic(image, settings.threads);
+            cv::setNumThreads(settings.threads);
+            bool saved = cv::imwrite(path, image);
+            cv::setNumThreads(1);
+            if (!saved) {
+                fprintf(stderr, "Error writing the output file: %s\n", path.c_str());
+                continue;
+            }
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "synthetic_%d", side);
+        benchFile(name, path, settings, tempDir, results);
+        unlink(path.c_str());
+    }
+
+    if (settings.corpus != NULL) {
+        std::vector<std::string> inputs;
+        if (ascii::collectBatchInputs(settings.corpus, inputs) != ascii::OK) {
+            fprintf(stderr, "Error reading the corpus: %s\n", settings.corpus);
+        }
+        for (size_t i = 0; i < inputs.size(); i++) {
+            benchFile(inputs[i], inputs[i], settings, tempDir, results);
+        }
+    }
+    rmdir(tempDir.c_str());
+
+    FILE* out = settings.output != NULL ? fopen(settings.output, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Error writing the output file: %s\n", settings.output);
+        return 1;
+    }
+    printJSON(out, settings, results);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,227 @@
+#include <opencv2/opencv.hpp>   // For cv::Vec3b (ANSI colors)
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <string>               // For the charset
+#include <vector>               // For the row buffers
+#include "ansi_color.h"         // For the ANSI escapes and the 256-color table
+#include "ascii_output.h"       // For writeAll()
+#include "cell_file.h"          // For reading cell files
+#include "glyph_atlas.h"        // For the PNG glyph masks
+#include "strip_encoder.h"      // For the threaded strip-wise PNG encoder
+
+// * Export formats
+#define EXPORT_TEXT    0
+#define EXPORT_ANSI    1
+#define EXPORT_ANSI256 2
+#define EXPORT_PNG     3
+
+#define EXPORT_FLUSH_BYTES  (1 << 20)  // Text buffered before each write()
+#define EXPORT_STRIP_ROWS   16         // Text rows rendered per PNG strip
+
+// Command line settings
+struct ExportSettings {
+    const char* input;
+    const char* output;     // NULL for stdout
+    int format;
+    int x, y, width, height;  // Region in cells, width 0 for the whole grid
+    int scale;              // PNG pixels per cell, 0 for the scales stored in the file
+};
+
+static void exportUsage(const char* programName) {
+    printf("Usage: %s FILE.cells [options]\n", programName);
+    printf("\nExports a cell file written by image_to_ascii (output path ending in .cells) as text, ANSI text or PNG,\n");
+    printf("without decoding the source image again. Only the rows of the region are read.\n");
+    printf("\nOptions:\n");
+    printf("  --format FORMAT      text, ansi, ansi256 or png (default: text).\n");
+    printf("  --region X,Y,W,H     Cells to export: left column, top row, width and height (default: every cell).\n");
+    printf("  --output FILE        Output file (default: stdout).\n");
+    printf("  --scale N            PNG pixels per character, both ways (default: the scales of the conversion).\n");
+}
+
+// Buffered text output: rows are appended and sent with one write() per EXPORT_FLUSH_BYTES
+struct TextSink {
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+};
+
+static int textSinkFlush(TextSink* sink) {
+    int status = writeAll(sink->fd, sink->buffer.data(), sink->used);
+    sink->used = 0;
+    return status;
+}
+
+// Room for n more bytes, flushing first if needed; returns NULL on a write error
+static char* textSinkReserve(TextSink* sink, size_t n) {
+    if (sink->used + n > sink->buffer.size() && textSinkFlush(sink) != 0) {
+        return NULL;
+    }
+    if (n > sink->buffer.size()) sink->buffer.resize(n);
+    return sink->buffer.data() + sink->used;
+}
+
+// Text and ANSI text: one row at a time into the sink
+// ANSI rows reuse the converter's row kernel, with glyph positions standing for intensities
+static int exportText(const CellFile* file, const ExportSettings& settings, int fd) {
+    unsigned char glyphTable[256];
+    for (int g = 0; g < 256; g++) glyphTable[g] = (unsigned char)cellFileGlyph(file, (unsigned char)g);
+    std::vector<unsigned char> paletteTable;
+    if (settings.format == EXPORT_ANSI256) {
+        paletteTable.resize(ANSI_PALETTE_SIZE);
+        buildAnsi256Table(paletteTable.data());
+    }
+    int mode = settings.format == EXPORT_ANSI256 ? ANSI_MODE_256 : ANSI_MODE_TRUECOLOR;
+
+    TextSink sink = {fd, std::vector<char>(EXPORT_FLUSH_BYTES), 0};
+    size_t rowBytes = settings.format == EXPORT_TEXT ? (size_t)settings.width + 1 : (size_t)settings.width * ANSI_MAX_CELL_BYTES + 5;
+    for (int i = settings.y; i < settings.y + settings.height; i++) {
+        const unsigned char* glyphs;
+        const unsigned char* colors;
+        cellFileRow(file, i, &glyphs, &colors);
+        char* dst = textSinkReserve(&sink, rowBytes);
+        if (dst == NULL) return -1;
+        glyphs += settings.x;
+        if (settings.format == EXPORT_TEXT) {
+            for (int j = 0; j < settings.width; j++) dst[j] = (char)glyphTable[glyphs[j]];
+            dst[settings.width] = '\n';
+            sink.used += rowBytes;
+        } else {
+            sink.used += ansiRowToText(glyphs, (const cv::Vec3b*)(colors + 3 * (size_t)settings.x), settings.width, glyphTable,
+                                       paletteTable.data(), mode, dst);
+        }
+    }
+    return textSinkFlush(&sink);
+}
+
+// PNG: the region is rendered a strip of text rows at a time while the encoder thread compresses the previous one
+static int exportPNG(const CellFile* file, const ExportSettings& settings, const char* path) {
+    int widthScale = settings.scale > 0 ? settings.scale : file->widthScale;
+    int heightScale = settings.scale > 0 ? settings.scale : file->heightScale;
+    if (widthScale < 1 || heightScale < 1) {
+        fprintf(stderr, "Error: the cell file has no scales, use --scale.\n");
+        return -1;
+    }
+    GlyphAtlas atlas;
+    std::string charset(file->charset, file->charsetLength);
+    if (glyphAtlasBuild(&atlas, charset.c_str(), widthScale, heightScale) != 0) {
+        return -1;
+    }
+
+    int stripRows = settings.height < EXPORT_STRIP_ROWS ? settings.height : EXPORT_STRIP_ROWS;
+    StripEncoder encoder;
+    if (encoder.open(path, settings.width * widthScale, settings.height * heightScale, stripRows * heightScale) != 0) {
+        glyphAtlasFree(&atlas);
+        return -1;
+    }
+    std::vector<unsigned char> chars(settings.width);
+    int status = 0;
+    for (int first = settings.y; first < settings.y + settings.height && status == 0; first += stripRows) {
+        int count = first + stripRows < settings.y + settings.height ? stripRows : settings.y + settings.height - first;
+        int buffer = encoder.acquire();
+        if (buffer < 0) {
+            status = -1;
+            break;
+        }
+        for (int i = first; i < first + count; i++) {
+            const unsigned char* glyphs;
+            const unsigned char* colors;
+            cellFileRow(file, i, &glyphs, &colors);
+            for (int j = 0; j < settings.width; j++) chars[j] = (unsigned char)cellFileGlyph(file, glyphs[settings.x + j]);
+            glyphAtlasRenderCells(&atlas, chars.data(), colors != NULL ? colors + 3 * (size_t)settings.x : NULL, settings.width,
+                                  encoder.data(buffer) + (size_t)(i - first) * heightScale * encoder.stride(), encoder.stride());
+        }
+        encoder.submit(buffer, count * heightScale);
+    }
+    if (status != 0) {
+        encoder.abort();
+    } else if (encoder.finish() != 0) {
+        status = -1;
+    }
+    glyphAtlasFree(&atlas);
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    ExportSettings settings;
+    settings.input = NULL;
+    settings.output = NULL;
+    settings.format = EXPORT_TEXT;
+    settings.x = settings.y = settings.width = settings.height = 0;
+    settings.scale = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--format") == 0 && hasValue) {
+            const char* format = argv[++i];
+            if (strcmp(format, "text") == 0) settings.format = EXPORT_TEXT;
+            else if (strcmp(format, "ansi") == 0) settings.format = EXPORT_ANSI;
+            else if (strcmp(format, "ansi256") == 0) settings.format = EXPORT_ANSI256;
+            else if (strcmp(format, "png") == 0) settings.format = EXPORT_PNG;
+            else {
+                fprintf(stderr, "Invalid format: %s\n", format);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--region") == 0 && hasValue) {
+            i++;
+            if (sscanf(argv[i], "%d,%d,%d,%d", &settings.x, &settings.y, &settings.width, &settings.height) != 4 ||
+                settings.x < 0 || settings.y < 0 || settings.width < 1 || settings.height < 1) {
+                fprintf(stderr, "Invalid region: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            settings.output = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && hasValue) {
+            settings.scale = atoi(argv[++i]);
+            if (settings.scale < 0) settings.scale = 0;
+        } else if (argv[i][0] != '-' && settings.input == NULL) {
+            settings.input = argv[i];
+        } else {
+            exportUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (settings.input == NULL) {
+        exportUsage(argv[0]);
+        return 1;
+    }
+
+    CellFile file;
+    if (cellFileOpen(&file, settings.input) != 0) {
+        fprintf(stderr, "Error: not a cell file: %s\n", settings.input);
+        return 1;
+    }
+    // The region is clipped to the grid
+    if (settings.width == 0) {
+        settings.width = file.cols;
+        settings.height = file.rows;
+    }
+    if (settings.x >= file.cols || settings.y >= file.rows) {
+        fprintf(stderr, "Error: the region is outside the %dx%d cell grid.\n", file.cols, file.rows);
+        cellFileClose(&file);
+        return 1;
+    }
+    if (settings.width > file.cols - settings.x) settings.width = file.cols - settings.x;
+    if (settings.height > file.rows - settings.y) settings.height = file.rows - settings.y;
+    if ((settings.format == EXPORT_ANSI || settings.format == EXPORT_ANSI256) && !(file.flags & CELL_FILE_COLOR)) {
+        fprintf(stderr, "Error: the cell file has no colors (convert with --color or --ansi).\n");
+        cellFileClose(&file);
+        return 1;
+    }
+    cellFilePrefetch(&file, settings.y, settings.height);
+
+    int status;
+    if (settings.format == EXPORT_PNG) {
+        status = exportPNG(&file, settings, settings.output != NULL ? settings.output : "/dev/stdout");
+    } else {
+        int fd = settings.output != NULL ? open(settings.output, O_WRONLY | O_CREAT | O_TRUNC, 0644) : STDOUT_FILENO;
+        status = fd < 0 ? -1 : exportText(&file, settings, fd);
+        if (fd >= 0 && fd != STDOUT_FILENO && close(fd) != 0) status = -1;
+    }
+    cellFileClose(&file);
+    if (status != 0) {
+        fprintf(stderr, "Error writing the output: %s\n", settings.output != NULL ? settings.output : "stdout");
+        return 1;
+    }
+    return 0;
+}
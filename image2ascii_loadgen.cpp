@@ -0,0 +1,225 @@
+#include <stdio.h>              // Default lib for input/output
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <signal.h>             // For ignoring SIGPIPE
+#include <algorithm>            // For the percentiles
+#include <atomic>               // For the shared request counter
+#include <string>               // For the charset
+#include <thread>               // For the concurrent clients
+#include <vector>               // For the latencies
+#include "image2ascii.h"        // For the modes and status codes
+#include "serve_protocol.h"     // For the wire format and sockets
+#include "thread_pool.h"        // For monotonicSeconds()
+
+// * Default values
+#define LOADGEN_DEFAULT_REQUESTS    1000
+#define LOADGEN_DEFAULT_CONCURRENCY 8
+
+// Command line settings
+struct LoadgenSettings {
+    const char* address;
+    const char* image;
+    int requests;
+    int concurrency;
+    ascii::Mode mode;
+    int scale;              // 0 for the server default
+    const char* charset;    // NULL for the server default
+};
+
+// Requests and latencies of one client connection
+struct LoadgenClient {
+    std::vector<double> latencies;  // Seconds, successful requests only
+    int errors;
+};
+
+static void loadgenUsage(const char* programName) {
+    printf("Usage: %s --address ADDRESS --image FILE [options]\n", programName);
+    printf("\nSends the same conversion request to an image_to_ascii --serve daemon from concurrent connections\n");
+    printf("and prints the latency percentiles as JSON.\n");
+    printf("\nOptions:\n");
+    printf("  --address ADDRESS    Unix socket path, PORT or HOST:PORT of the server.\n");
+    printf("  --image FILE         Image sent with every request.\n");
+    printf("  --requests N         Requests in total (default: %d).\n", LOADGEN_DEFAULT_REQUESTS);
+    printf("  --concurrency N      Connections sending at once (default: %d).\n", LOADGEN_DEFAULT_CONCURRENCY);
+    printf("  --mode MODE          text, color, ansi, ansi256, halfblock or braille (default: text).\n");
+    printf("  --scale N            Pixels per character, both ways (default: the server's).\n");
+    printf("  --charset CHARS      Charset, darkest first (default: the server's).\n");
+}
+
+// Reads a whole file, returns 0 on success and -1 on error
+static int readFile(const char* path, std::vector<unsigned char>& bytes) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return -1;
+    unsigned char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + got);
+    }
+    int status = ferror(file) ? -1 : 0;
+    fclose(file);
+    return status;
+}
+
+// One connection sending requests back to back until the shared counter runs out
+static void loadgenClient(const LoadgenSettings& settings, const std::vector<unsigned char>& request,
+                          std::atomic<int>& remaining, LoadgenClient& client) {
+    int fd = serveSocket(settings.address, false, 0);
+    std::vector<unsigned char> reply;
+    while (remaining.fetch_sub(1) > 0) {
+        if (fd < 0) {
+            client.errors++;
+            continue;
+        }
+        double start = monotonicSeconds();
+        unsigned char header[SERVE_RESPONSE_SIZE];
+        ServeResponse response;
+        if (writeAll(fd, (const char*)request.data(), request.size()) != 0 || readAll(fd, header, sizeof(header)) != 0 ||
+            serveDecodeResponse(header, &response) != 0) {
+            client.errors++;
+            close(fd);
+            fd = -1;  // The stream is out of step, the rest of this client's requests fail
+            continue;
+        }
+        reply.resize((size_t)response.length);
+        if (!reply.empty() && readAll(fd, reply.data(), reply.size()) != 0) {
+            client.errors++;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        if (response.status == ascii::OK) {
+            client.latencies.push_back(monotonicSeconds() - start);
+        } else {
+            client.errors++;
+        }
+    }
+    if (fd >= 0) close(fd);
+}
+
+// Writes s as a JSON string literal
+static void printJSONString(FILE* out, const std::string& s) {
+    fputc('"', out);
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Latency at percentile p (0 to 100) of sorted latencies, in milliseconds
+static double percentileMs(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = (size_t)(p / 100.0 * (double)(sorted.size() - 1) + 0.5);
+    return sorted[index] * 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    LoadgenSettings settings;
+    settings.address = NULL;
+    settings.image = NULL;
+    settings.requests = LOADGEN_DEFAULT_REQUESTS;
+    settings.concurrency = LOADGEN_DEFAULT_CONCURRENCY;
+    settings.mode = ascii::MODE_TEXT;
+    settings.scale = 0;
+    settings.charset = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--address") == 0 && hasValue) {
+            settings.address = argv[++i];
+        } else if (strcmp(argv[i], "--image") == 0 && hasValue) {
+            settings.image = argv[++i];
+        } else if (strcmp(argv[i], "--requests") == 0 && hasValue) {
+            settings.requests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--concurrency") == 0 && hasValue) {
+            settings.concurrency = atoi(argv[++i]);
+            if (settings.concurrency < 1) settings.concurrency = 1;
+        } else if (strcmp(argv[i], "--mode") == 0 && hasValue) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "text") == 0) settings.mode = ascii::MODE_TEXT;
+            else if (strcmp(mode, "color") == 0) settings.mode = ascii::MODE_COLOR_IMAGE;
+            else if (strcmp(mode, "ansi") == 0) settings.mode = ascii::MODE_ANSI_TRUECOLOR;
+            else if (strcmp(mode, "ansi256") == 0) settings.mode = ascii::MODE_ANSI_256;
+            else if (strcmp(mode, "halfblock") == 0) settings.mode = ascii::MODE_HALF_BLOCK;
+            else if (strcmp(mode, "braille") == 0) settings.mode = ascii::MODE_BRAILLE;
+            else {
+                fprintf(stderr, "Invalid mode: %s\n", mode);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scale") == 0 && hasValue) {
+            settings.scale = atoi(argv[++i]);
+            if (settings.scale < 0) settings.scale = 0;
+        } else if (strcmp(argv[i], "--charset") == 0 && hasValue) {
+            settings.charset = argv[++i];
+        } else {
+            loadgenUsage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (settings.address == NULL || settings.image == NULL) {
+        loadgenUsage(argv[0]);
+        return 1;
+    }
+
+    // The request is encoded once and sent as is by every client
+    std::vector<unsigned char> image;
+    if (readFile(settings.image, image) != 0) {
+        fprintf(stderr, "Error loading the image: %s\n", settings.image);
+        return 1;
+    }
+    std::string charset = settings.charset != NULL ? settings.charset : "";
+    ServeRequest header = {(unsigned int)settings.mode, (unsigned int)settings.scale, (unsigned int)settings.scale,
+                           (unsigned int)charset.size(), (unsigned long long)image.size()};
+    if (header.charsetLength > SERVE_MAX_CHARSET) {  // The image limit is the server's (--max-request), it answers over it
+        fprintf(stderr, "Error: the charset is over the server limit.\n");
+        return 1;
+    }
+    std::vector<unsigned char> request(SERVE_REQUEST_SIZE);
+    serveEncodeRequest(&header, request.data());
+    request.insert(request.end(), charset.begin(), charset.end());
+    request.insert(request.end(), image.begin(), image.end());
+
+    signal(SIGPIPE, SIG_IGN);  // A server gone mid-request counts as an error, not a crash
+    std::atomic<int> remaining(settings.requests);
+    std::vector<LoadgenClient> clients(settings.concurrency);
+    std::vector<std::thread> threads;
+    double start = monotonicSeconds();
+    for (int c = 0; c < settings.concurrency; c++) {
+        clients[c].errors = 0;
+        threads.push_back(std::thread(loadgenClient, std::cref(settings), std::cref(request), std::ref(remaining), std::ref(clients[c])));
+    }
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    double seconds = monotonicSeconds() - start;
+
+    std::vector<double> latencies;
+    int errors = 0;
+    for (size_t c = 0; c < clients.size(); c++) {
+        latencies.insert(latencies.end(), clients[c].latencies.begin(), clients[c].latencies.end());
+        errors += clients[c].errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double meanMs = 0.0;
+    for (size_t i = 0; i < latencies.size(); i++) meanMs += latencies[i] * 1000.0;
+    if (!latencies.empty()) meanMs /= (double)latencies.size();
+
+    printf("{\"loadgen\":\"image2ascii\",\"address\":");
+    printJSONString(stdout, settings.address);
+    printf(",\"image\":");
+    printJSONString(stdout, settings.image);
+    printf(",\"request_bytes\":%zu,", request.size());
+    printf("\"requests\":%d,\"concurrency\":%d,\"succeeded\":%zu,\"errors\":%d,\"seconds\":%.3f,\"requests_per_sec\":%.1f,",
+           settings.requests, settings.concurrency, latencies.size(), errors, seconds,
+           seconds > 0.0 ? (double)latencies.size() / seconds : 0.0);
+    printf("\"latency_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n", meanMs,
+           percentileMs(latencies, 50.0), percentileMs(latencies, 90.0), percentileMs(latencies, 99.0),
+           percentileMs(latencies, 100.0));
+    return errors == 0 ? 0 : 1;
+}
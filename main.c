@@ -1,63 +1,111 @@
-#include <opencv2/opencv.hpp>   // For image manipulation
-#include <stdio.h>              // Default lib for input/output
-#include <stdlib.h>             // For basic functions
-#include <string.h>             // For string manipulation
-
-// * Default values
-#define DEFAULT_WIDTH_SCALE 10            // Width factor for scaling (characters are more long and taller)
-#define DEFAULT_HEIGHT_SCALE 10           // Height factor for scaling (characters are more long and taller)
-#define DEFAULT_ASCII_CHARS " .:-=+*#%@"  // Permited ASCII characters
-#define DEFAULT_OUTPUT_PATH "output.txt"  // Default output file name and path
-
-// Fuction for maping intensity for ASCII characters
-// The value can be between 0 and 255
-char intensityToASCII(int intensity, const char* asciiChars) {
-    int len = strlen(asciiChars);
-    return asciiChars[(intensity * (len - 1)) / 255];
-}
-
-// Function to convert RGB values to an ANSI escape code for text foreground color
-char* rgbToAnsiColor(cv::Vec3b pixel) {
-    static char colorCode[20];
-    // Convert RGB to an ANSI escape code for foreground color (e.g., 38;2;R;G;B)
-    snprintf(colorCode, sizeof(colorCode), "\033[38;2;%d;%d;%dm", pixel[2], pixel[1], pixel[0]);
-    return colorCode;  // Return the ANSI escape code for the color
-}
-
-// Function to see if format is correct for colored image
-int endsWithAllowedFormat(const char* path) {
-    // Allowed extensions
-    const char* allowedFormats[] = {".png", ".jpeg", ".webp"};
-    int numFormats = 3;  // Número de formatos permitidos
-
-    for (int i = 0; i < numFormats; i++) {
-        int len = strlen(allowedFormats[i]);
-        int pathLen = strlen(path);
-        if (pathLen >= len && strcmp(path + pathLen - len, allowedFormats[i]) == 0) {
-            return 1;  // If is allowed return 1
-        }
-    }
-
-    return 0;  // If not allowed return 0
-}
-
-// Display help if --help flag
-void helpFlag(const char* programName) {
-    printf("Usage Manual - Image to ASCII Converter\n");
-    printf("\nUsage: %s <image_path> [options]\n", programName);
-    printf("\nOptions:\n");
-    printf("  --help             Displays this usage manual.\n");
-    printf("  --default          Uses default values without asking for user input.\n");
-    printf("\nUser Inputs:\n");
-    printf("  - Color preference: Type 1 to use color, or any other number for black and white.\n");
-    printf("  - Image path: The input file must be a valid image.\n");
-    printf("  - Width and height scale: Scale factors to adjust the aspect ratio.\n");
-    printf("  - ASCII characters: Set of characters to represent the image.\n");
-    printf("\nExample Usage:\n");
-    printf("  %s image.png\n", programName);
-    printf("  %s image.png --default\n", programName);
-    printf("  %s image.png --help\n", programName);
-}
+#include "ascii_cli.h"          // For the shared command line
+
+// English messages of the command line (formats and arguments are described in ascii_cli.h)
+static const CliStrings englishStrings = {
+    // help
+    "Usage Manual - Image to ASCII Converter\n"
+    "\nUsage: %1$s <image_path> [options]\n"
+    "The image path can be \"-\" to read the image from stdin.\n"
+    "\nOptions:\n"
+    "  --help             Displays this usage manual.\n"
+    "  --default          Uses default values without asking for user input.\n"
+    "  --output PATH      Output file, used as given (\"-\" writes to stdout).\n"
+    "  --width-scale N    Pixels per character, horizontally (default: %2$d).\n"
+    "  --height-scale N   Pixels per character, vertically (default: %3$d).\n"
+    "  --chars CHARS      Characters to use, darkest first (default: \"%4$s\").\n"
+    "  --no-echo          Does not show the text result in the terminal.\n"
+    "  --mmap             Writes the text file through an mmap'd region.\n"
+    "  --threads N        Number of conversion threads (default: every core).\n"
+    "  --color            Renders a colored image.\n"
+    "  --ansi             Writes colored text with 24-bit ANSI escapes (file and terminal).\n"
+    "  --ansi256          Writes colored text with the 256-color ANSI palette.\n"
+    "  --half-block       Writes colored half blocks (two pixels per character, 24-bit ANSI).\n"
+    "  --braille          Writes Braille patterns (2x4 dots per character, UTF-8).\n"
+    "  --shape            Picks glyphs by shape (4x4 subcells) instead of brightness, for plain text.\n"
+    "  --dither MODE      Dithers plain text glyphs: ordered (Bayer) or floyd (Floyd-Steinberg).\n"
+    "  --batch INPUTS     Converts a directory, a glob pattern or a file list (one path per line).\n"
+    "  --out-dir DIR      Output directory of --batch mode (default: \".\").\n"
+    "  --video SOURCE     Plays a video file, /dev/video* or camera index as ASCII in the terminal.\n"
+    "  --max-memory SIZE  Streams PNG/JPEG inputs in strips within SIZE bytes (K, M or G suffix).\n"
+    "  --view             Opens the image in an interactive terminal viewer (arrows pan, +/- zoom, q quits).\n"
+    "  --serve ADDRESS    Serves conversions on a Unix socket path, PORT or HOST:PORT (localhost TCP).\n"
+    "  --workers N        Requests --serve converts at once (default: every core).\n"
+    "  --queue N          Requests --serve keeps waiting for a worker (default: --workers).\n"
+    "  --max-request SIZE Largest image a --serve request may send (K, M or G suffix, default: 256M).\n"
+    "  --pyramid LEVELS   Writes several sizes from one decode: columns (80,160) or scales (10x20,5x10).\n"
+    "  --cells FILE       Writes the character grid (and colors) to FILE for image2ascii_export.\n"
+    "  --cache DIR        Reuses earlier results of the same image and options from DIR (no decoding).\n"
+    "  --cache-limit SIZE Size of --cache before the least recently used results are dropped (default: 1G).\n"
+    "  --stats[=json]     Prints stage timings, throughput and peak memory on stderr (text or JSON).\n"
+    "  --self-test        Checks the glyph tables and shape matching against the reference kernels.\n"
+    "\nUser Inputs (asked only on a terminal, for the values no flag gives):\n"
+    "  - Color preference: Type 1 to use color, or any other number for black and white.\n"
+    "  - Image path: The input file must be a valid image.\n"
+    "  - Width and height scale: Scale factors to adjust the aspect ratio.\n"
+    "  - ASCII characters: Set of characters to represent the image.\n"
+    "\nExample Usage:\n"
+    "  %1$s image.png\n"
+    "  %1$s image.png --default\n"
+    "  %1$s image.png --help\n"
+    "  %1$s --batch photos/ --out-dir ascii/\n"
+    "  %1$s - --output - --width-scale 4 --height-scale 8 < image.png > image.txt\n"
+    "  %1$s --video movie.mp4\n"
+    "  %1$s panorama.jpg --view --ansi\n",
+    "Usage: %s <image_path> [options]\n\n\nType --help for more information.\n",  // usage
+    "Error: unknown argument %s\n",  // unknownOption
+    "Error: %s needs a value\n",  // missingValue
+    "Error: invalid value for %s: %s\n",  // invalidValue
+    "Self-test failed: %d mismatches.\n",  // selfTestFailed
+    "Self-test passed: every glyph table matches.",  // selfTestPassed
+    "Converted: %s -> %s\n",  // batchConverted
+    "Error loading the image: %s\n",  // batchLoadError
+    "Error: image smaller than one character: %s\n",  // batchSizeError
+    "Error writing the output file: %s\n",  // batchOutputError
+    "Error converting the image: %s\n",  // batchConvertError
+    "Error: the image does not fit in --max-memory (only PNG and JPEG inputs are streamed): %s\n",  // batchMemoryError
+    "Error: no directory, pattern or file list at \"%s\".\n",  // batchInputsError
+    "Batch complete! %d converted, %d failed.\n",  // batchComplete
+    "%.1f fps | %d bytes/frame | %d dropped",  // videoStatus
+    "Error opening the video source.",  // videoError
+    "Error: --video plays plain text only (not --color, --ansi, --ansi256, --half-block or --braille).",  // videoModeError
+    "x %d y %d | %dx%d px/cell | level %d | %d tiles converted, %d reused | %.1f ms | arrows/hjkl +/- 0 q",  // viewStatus
+    "Error: --view needs an image file and a terminal.",  // viewError
+    "Serving on %s (Ctrl+C to stop).\n",  // serving
+    "Error opening the server socket: %s\n",  // serveError
+    "Server stopped.",  // serverStopped
+    "Using default values...",  // usingDefaults
+    "Type 1 to convert with color or any other key to proceed without color: ",  // promptColor
+    "Enter the output file path and name (default: \"%s\"): ",  // promptOutput
+    "Enter the scale factor for width (default: %d): ",  // promptWidth
+    "Enter the scale factor for height (default: %d): ",  // promptHeight
+    "Enter the ASCII characters to use (default: \"%s\"): ",  // promptChars
+    "Error: --chars takes at most 256 characters.",  // charsError
+    "Error: The path is too long for the output file.",  // pathError
+    "Error: the --cells file name must end in .cells.",  // cellsNameError
+    "Error: --braille and --half-block cannot be stored in a cell file, their cells are not charset glyphs.",  // cellsModeError
+    "Error: invalid --pyramid levels \"%s\" (columns like 80,160 or scales like 10x20,5x10).\n",  // pyramidError
+    "Error: --pyramid needs an input file and output files (not \"-\").",  // pyramidPathError
+    "Error loading the image.",  // loadError
+    "Error: the image is smaller than one character.",  // sizeError
+    "Error writing the output file.",  // outputError
+    "Error: the image does not fit in --max-memory (only PNG and JPEG inputs are streamed).",  // memoryError
+    "Error: --dither cannot be combined with --max-memory, the strips would be dithered apart.",  // ditherMemoryError
+    "Error converting the image.",  // convertError
+    "Level saved in '%s'\n",  // levelSaved
+    "Conversion complete! %d levels saved.\n",  // pyramidComplete
+    "Image generated and saved as: %s\n",  // imageSaved
+    "Conversion complete! Result saved in '%s'\n",  // complete
+    "Cache: %lld hits, %lld misses.\n",  // cacheReport
+    "Stats:",  // statsTitle
+    {"decode", "resize", "convert", "render", "write"},  // stageNames
+    "wall",  // statsWall
+    "cells",  // statsCells
+    "cells/s",  // statsCellsRate
+    "written",  // statsWritten
+    "%lld hits, %lld misses",  // statsCache
+    "peak RSS",  // statsPeak
+    "  thread %d  %d bands, %.3f ms busy\n"  // statsThread
+};
 
 /**
  * @brief Main function for the image to ASCII conversion program.
@@ -70,212 +118,5 @@ void helpFlag(const char* programName) {
  * @return 0 if the program runs successfully, -1 if an error occurs.
  */
 int main(int argc, char** argv) {
-    cv::setNumThreads(1);
-
-    // Display help manual if --help is passed
-    if (argc == 2 && strcmp(argv[1], "--help") == 0) {
-        helpFlag(argv[0]); // Display help manual in terminal
-        return 0; // Exit after displaying help
-    }
-
-    int widthScale = DEFAULT_WIDTH_SCALE;     // Default
-    int heightScale = DEFAULT_HEIGHT_SCALE;   // Default
-    int colorChoice = 0;                      // Default
-    char asciiChars[100];                     // Array to store user-defined ASCII characters (100 MAX)
-    char userPath[200];                       // Array to store user input output path
-    char outputPath[300];                     // Array to store user-defined output path
-    strcpy(asciiChars, DEFAULT_ASCII_CHARS);  // Initialize with default value
-    strcpy(outputPath, DEFAULT_OUTPUT_PATH);  // Initialize with default value
-
-    // If no path || invalid
-    if (argc < 2) {
-        printf("Usage: %s <image_path> [options]\n", argv[0]);
-        printf("\n\nType --help for more information.");
-        return -1;
-    }
-
-    // Check if the user provided the --default flag
-    bool useDefaults = false;
-    for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--default") == 0) {
-            useDefaults = true;
-            break;
-        }
-    }
-    
-    char input[10];  // Array to hold user input
-    if (useDefaults) {
-        // Use default values, no need to prompt the user
-        printf("Using default values...\n");
-    } else {
-        // IF THE --DEFAULT FLAG IS NOT USED - User inputs
-        // Ask the user for the color preference
-        printf("Type 1 to convert with color or any other key to proceed without color: ");
-        if (fgets(input, sizeof(input), stdin) != NULL) {
-            // If input is empty (i.e., just Enter)
-            if (input[0] == '\n') {
-                colorChoice = 0;  // Default to 0 if input is empty
-            } else {
-                // Try to convert the input to an integer
-                if (sscanf(input, "%d", &colorChoice) != 1) {
-                    colorChoice = 0;  // Set to 0 if conversion fails
-                }
-            }
-        }
-        if (colorChoice != 1) {
-            // Ask the user for the output file path
-            printf("Enter the output file path and name (default: \"%s\"): ", DEFAULT_OUTPUT_PATH);
-            if (fgets(userPath, sizeof(userPath), stdin) != NULL) {
-                if (userPath[0] == '\n') {
-                    strcpy(userPath, DEFAULT_OUTPUT_PATH); // Use default if input is empty
-                } else {
-                    userPath[strcspn(userPath, "\n")] = 0;  // Remove the newline at the end
-                }
-            }
-            // If user only provided a path but no filename, use "output.txt" as filename
-            if (userPath[strlen(userPath) - 1] == '/' || userPath[strlen(userPath) - 1] == '\\') {
-                // Check if the length of the path + "output.txt" fits into the buffer
-                if (strlen(userPath) + strlen("output.txt") < sizeof(outputPath)) {
-                    snprintf(outputPath, sizeof(outputPath), "%soutput.txt", userPath);  // Add "output.txt" to the given path
-                } else {
-                    printf("Error: The path is too long for the output file.\n");
-                    return -1; // If the path is too long
-                }
-            } else {
-                // If the user specified a file name but no extension, add ".txt"
-                if (strstr(userPath, ".txt") == NULL) {
-                    // Check if the user path fits within the buffer when adding ".txt"
-                    if (strlen(userPath) + strlen(".txt") < sizeof(outputPath)) {
-                        snprintf(outputPath, sizeof(outputPath), "%s.txt", userPath);  // Add ".txt" extension
-                    } else {
-                        printf("Error: The path is too long for the output file.\n");
-                        return -1; // If the path is too long
-                    }
-                } else {
-                    strncpy(outputPath, userPath, sizeof(outputPath) - 1);
-                    outputPath[sizeof(outputPath) - 1] = '\0';  // Ensure null termination
-                }
-            }
-        } else {
-            // Input for path
-            printf("Enter the file path (with extension, default: .png): ");
-            scanf("%s", userPath);
-
-            if (colorChoice == 1 && !endsWithAllowedFormat(userPath)) {
-                // If no endsWithAllowedFormat() puts .png format
-                strcat(userPath, ".png");
-                printf("The file will be saved as: %s\n", userPath);
-            } else {
-                printf("The file will be saved as: %s\n", userPath);
-            }
-            strcpy(outputPath, userPath);
-        }
-
-        // Ask the user for the width scale
-        printf("Enter the scale factor for width (default: %d): ", DEFAULT_WIDTH_SCALE);
-        char input[10];
-        if (fgets(input, sizeof(input), stdin) != NULL) {
-            if (input[0] != '\n') {  // If the user didn't just press Enter
-                if (sscanf(input, "%d", &widthScale) != 1) {
-                    widthScale = DEFAULT_WIDTH_SCALE; // Use default if invalid input
-                }
-            }
-        }
-
-        // Ask the user for the height scale
-        printf("Enter the scale factor for width (default: %d): ", DEFAULT_WIDTH_SCALE);
-        if (fgets(input, sizeof(input), stdin) != NULL) {
-            if (input[0] != '\n') {  // If the user didn't just press Enter
-                if (sscanf(input, "%d", &heightScale) != 1) {
-                    heightScale = DEFAULT_HEIGHT_SCALE; // Use default if invalid input
-                }
-            }
-        }
-
-        // Ask the user for ASCII characters
-        printf("Enter the ASCII characters to use (default: \"%s\"): ", DEFAULT_ASCII_CHARS);
-        if (fgets(asciiChars, sizeof(asciiChars), stdin) != NULL) {
-            if (asciiChars[0] == '\n') {
-                strcpy(asciiChars, DEFAULT_ASCII_CHARS); // Use default if input is empty
-            } else {
-                asciiChars[strcspn(asciiChars, "\n")] = 0;  // Remove the newline at the end
-            }
-        }
-    }
-
-    // Loads image in gray scale format
-    cv::Mat image = cv::imread(argv[1], cv::IMREAD_COLOR);
-    if (image.empty()) {
-        printf("Error loading the image.\n");
-        return -1;
-    }
-
-    // Image dimensions
-    int rows = image.rows / heightScale; // Reduce height to adjust proportion
-    int cols = image.cols / widthScale;  // Reduce width to adjust proportion
-
-    // Resize image for better result
-    cv::resize(image, image, cv::Size(cols, rows), 0, 0, cv::INTER_LINEAR);
-
-    // Create a .txt file as output
-    FILE* file = fopen(outputPath, "w");
-    if (file == NULL) {
-        printf("Error creating the output file.\n");
-        return -1;
-    }
-
-    // Convert image to ASCII version
-    // Two for loops for rows & columns
-    // The if statement is for color conversion
-    if (colorChoice == 1) {
-        cv::Mat output(rows * heightScale, cols * widthScale, CV_8UC3, cv::Scalar(0, 0, 0)); // Canvas
-
-        for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                cv::Vec3b pixel = image.at<cv::Vec3b>(i, j); // RGB pixel
-                char asciiChar = intensityToASCII(image.at<uchar>(i, j), asciiChars); // Grayscale intensity
-
-                // Draw ASCII character on the image
-                cv::putText(
-                    output,
-                    std::string(1, asciiChar),  // Single ASCII character as string
-                    cv::Point(j * widthScale, i * heightScale),  // Position
-                    cv::FONT_HERSHEY_SIMPLEX,  // Font type
-                    0.5,                       // Font scale
-                    cv::Scalar(pixel[0], pixel[1], pixel[2]),  // Color (BGR)
-                    1                          // Thickness
-                );
-            }
-        }
-
-        // Save the rendered image
-        cv::imwrite(outputPath, output);
-        printf("Image generated and saved as: %s\n", outputPath);
-
-    } else {
-        // Convert to grayscale
-        cv::Mat grayImage;
-        if (image.channels() > 1) {
-            cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
-        } else {
-            grayImage = image;
-        }
-
-        // Process each pixel
-        for (int i = 0; i < grayImage.rows; i++) {
-            for (int j = 0; j < grayImage.cols; j++) {
-                int intensity = grayImage.at<uchar>(i, j);  // Intensity (0 - 255)
-                char asciiChar = intensityToASCII(intensity, asciiChars);  // Convert to ASCII
-                fprintf(file, "%c", asciiChar); // Write in file
-                printf("%c", asciiChar);       // Show in terminal
-            }
-            fprintf(file, "\n");  // File breakline at the end of each row
-            printf("\n");         // Terminal breakline at the end of each row
-        }
-    }
-
-    fclose(file); // Closes file
-    printf("Conversion complete! Result saved in '%s'\n", outputPath); // Success log
-
-    return 0; // Success
-}
\ No newline at end of file
+    return runCli(argc, argv, englishStrings);
+}
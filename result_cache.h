@@ -0,0 +1,252 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdio.h>              // For snprintf() / rename()
+#include <stdint.h>             // For the 64-bit hashes
+#include <stdlib.h>             // For mkstemp()
+#include <string.h>             // For string manipulation
+#include <ctype.h>              // For the output extension
+#include <dirent.h>             // For the eviction scan
+#include <errno.h>              // For EINTR retries
+#include <fcntl.h>              // For open()
+#include <time.h>               // For the age of stale temporary files
+#include <unistd.h>             // For read() / write() / unlink()
+#include <sys/mman.h>           // For hashing the input in place
+#include <sys/stat.h>           // For sizes and access times
+#include <sys/time.h>           // For utimes()
+#ifdef __linux__
+#include <sys/sendfile.h>       // For kernel-side copies
+#endif
+#include <algorithm>            // For sorting the entries by age
+#include <string>               // For keys and paths
+#include <vector>               // For the eviction scan
+#include "image2ascii.h"        // For the options of the key
+#include "ascii_output.h"       // For writeAll()
+
+// Result cache: cacheDir/<input hash>-<input size>-<options hash>.<output extension> holds a finished output
+// A hit copies it to the output path without decoding; entries are published with rename() (atomic, so
+// concurrent processes never see a partial entry) and evicted least recently used first over the size limit
+#define CACHE_KEY_VERSION  "1"          // Part of the options hash, bump it when an output format changes
+#define CACHE_TEMP_PREFIX  ".tmp-"      // Entries being written, skipped by lookups
+#define CACHE_TEMP_MAX_AGE (24 * 3600)  // Seconds before an abandoned temporary file is evicted
+
+// * XXH64 (public domain algorithm by Yann Collet), 8 bytes per step, for the content and options hashes
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t xxhRotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t xxhRead64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);  // Little-endian hosts only (every target of this project)
+    return v;
+}
+
+static inline uint32_t xxhRead32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME64_2;
+    return xxhRotl(acc, 31) * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxhMerge(uint64_t acc, uint64_t v) {
+    acc ^= xxhRound(0, v);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline uint64_t xxh64(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2, v2 = seed + XXH_PRIME64_2, v3 = seed, v4 = seed - XXH_PRIME64_1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = xxhRound(v1, xxhRead64(p));
+            v2 = xxhRound(v2, xxhRead64(p + 8));
+            v3 = xxhRound(v3, xxhRead64(p + 16));
+            v4 = xxhRound(v4, xxhRead64(p + 24));
+        }
+        h = xxhRotl(v1, 1) + xxhRotl(v2, 7) + xxhRotl(v3, 12) + xxhRotl(v4, 18);
+        h = xxhMerge(xxhMerge(xxhMerge(xxhMerge(h, v1), v2), v3), v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+    h += (uint64_t)size;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxhRound(0, xxhRead64(p));
+        h = xxhRotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)xxhRead32(p) * XXH_PRIME64_1;
+        h = xxhRotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxhRotl(h, 11) * XXH_PRIME64_1;
+    }
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Hashes the bytes of a file (mmap'd, nothing is decoded)
+// Returns 0 on success and -1 if the file cannot be read
+static inline int hashFile(const char* path, uint64_t* hash, uint64_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    *size = (uint64_t)info.st_size;
+    if (info.st_size == 0) {
+        *hash = xxh64(NULL, 0, 0);
+        close(fd);
+        return 0;
+    }
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+    *hash = xxh64(data, (size_t)info.st_size, 0);
+    munmap(data, (size_t)info.st_size);
+    return 0;
+}
+
+// Cache key of converting inputPath to outputPath with options
+// The options hash covers everything that changes the output bytes: mode, glyph match, dither, scales, charset,
+// output format and streaming
+// Returns 0 on success and -1 if the input cannot be read
+static inline int cacheKey(const char* inputPath, const char* outputPath, const ascii::Options& options, std::string& key) {
+    uint64_t contentHash, size;
+    if (hashFile(inputPath, &contentHash, &size) != 0) return -1;
+
+    std::string extension;
+    const char* dot = strrchr(outputPath, '.');
+    if (dot != NULL && strchr(dot, '/') == NULL) {
+        for (const char* c = dot + 1; *c != '\0'; c++) extension += (char)tolower((unsigned char)*c);
+    }
+    char normalized[96];
+    snprintf(normalized, sizeof(normalized), "v" CACHE_KEY_VERSION " mode=%d match=%d dither=%d scale=%dx%d stream=%d format=",
+             (int)options.mode, (int)options.match, (int)options.dither, options.widthScale, options.heightScale,
+             options.maxMemory > 0 ? 1 : 0);
+    std::string optionSet = normalized + extension + " charset=" + options.asciiChars;
+    uint64_t optionsHash = xxh64(optionSet.data(), optionSet.size(), 0);
+
+    char name[80];
+    snprintf(name, sizeof(name), "%016llx-%llu-%016llx.%s", (unsigned long long)contentHash, (unsigned long long)size,
+             (unsigned long long)optionsHash, extension.empty() ? "out" : extension.c_str());
+    key = name;
+    return 0;
+}
+
+// Copies size bytes from in to out (sendfile() in the kernel when it can, read/write otherwise)
+// Returns 0 on success and -1 on error
+static inline int copyFileBytes(int in, int out, size_t size) {
+#ifdef __linux__
+    while (size > 0) {
+        ssize_t sent = sendfile(out, in, NULL, size);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) break;  // EINVAL / ENOSYS: file systems or descriptors sendfile() does not take
+        size -= (size_t)sent;
+    }
+    if (size == 0) return 0;
+#endif
+    char buffer[65536];
+    while (size > 0) {
+        ssize_t got = read(in, buffer, size < sizeof(buffer) ? size : sizeof(buffer));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0 || writeAll(out, buffer, (size_t)got) != 0) return -1;
+        size -= (size_t)got;
+    }
+    return 0;
+}
+
+// Copies the whole file at from into out
+// Returns 0 on success and -1 on error
+static inline int copyFileTo(const char* from, int out) {
+    int in = open(from, O_RDONLY);
+    if (in < 0) return -1;
+    struct stat info;
+    int status = (fstat(in, &info) == 0 && copyFileBytes(in, out, (size_t)info.st_size) == 0) ? 0 : -1;
+    close(in);
+    return status;
+}
+
+// Hit: copies the entry to outputPath (and to the terminal with echo) and marks it recently used
+// Returns 0 on a hit and -1 on a miss or if the entry could not be copied
+static inline int cacheFetch(const char* cacheDir, const std::string& key, const char* outputPath, bool echo) {
+    std::string entry = std::string(cacheDir) + "/" + key;
+    if (access(entry.c_str(), R_OK) != 0) return -1;
+    int out = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) return -1;
+    int status = copyFileTo(entry.c_str(), out);
+    if (close(out) != 0) status = -1;
+    if (status != 0) return -1;
+    if (echo && copyFileTo(entry.c_str(), STDOUT_FILENO) != 0) return -1;
+    utimes(entry.c_str(), NULL);  // Access order for LRU eviction (mtime, atime is often disabled)
+    return 0;
+}
+
+// Least recently used entries are deleted until the cache holds at most limit bytes
+// Entries and abandoned temporary files of every process count, in-flight temporary files are left alone
+static inline void cacheEvict(const char* cacheDir, unsigned long long limit) {
+    DIR* dir = opendir(cacheDir);
+    if (dir == NULL) return;
+    std::vector<std::pair<time_t, std::pair<unsigned long long, std::string>>> entries;  // mtime, size, path
+    unsigned long long total = 0;
+    time_t now = time(NULL);
+    for (struct dirent* item = readdir(dir); item != NULL; item = readdir(dir)) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) continue;
+        std::string path = std::string(cacheDir) + "/" + item->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+        bool temporary = strncmp(item->d_name, CACHE_TEMP_PREFIX, strlen(CACHE_TEMP_PREFIX)) == 0;
+        if (temporary && now - info.st_mtime < CACHE_TEMP_MAX_AGE) continue;
+        total += (unsigned long long)info.st_size;
+        entries.push_back(std::make_pair(temporary ? (time_t)0 : info.st_mtime,
+                                         std::make_pair((unsigned long long)info.st_size, path)));
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() && total > limit; i++) {
+        if (unlink(entries[i].second.second.c_str()) == 0 || errno == ENOENT) {
+            total -= entries[i].second.first;  // Another process may have evicted it first
+        }
+    }
+}
+
+// Miss: publishes outputPath as the entry of key (temporary file + rename), then evicts down to limit
+// Returns 0 on success and -1 on error (the conversion itself already succeeded)
+static inline int cacheStore(const char* cacheDir, const std::string& key, const char* outputPath, unsigned long long limit) {
+    mkdir(cacheDir, 0755);  // The first store creates the directory
+    std::string temporary = std::string(cacheDir) + "/" CACHE_TEMP_PREFIX "XXXXXX";
+    int out = mkstemp(&temporary[0]);
+    if (out < 0) return -1;
+    fchmod(out, 0644);
+    int status = copyFileTo(outputPath, out);
+    if (close(out) != 0) status = -1;
+    std::string entry = std::string(cacheDir) + "/" + key;
+    if (status != 0 || rename(temporary.c_str(), entry.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return -1;
+    }
+    cacheEvict(cacheDir, limit);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef SERVE_PROTOCOL_H
+#define SERVE_PROTOCOL_H
+
+#include <stdio.h>              // For snprintf()
+#include <string.h>             // For string manipulation
+#include <errno.h>              // For EINTR retries
+#include <unistd.h>             // For read() / close()
+#include <netdb.h>              // For getaddrinfo()
+#include <netinet/in.h>         // For TCP addresses
+#include <netinet/tcp.h>        // For TCP_NODELAY
+#include <sys/socket.h>         // For sockets
+#include <sys/stat.h>           // For replacing stale Unix sockets
+#include <sys/un.h>             // For Unix socket addresses
+#include "ascii_output.h"       // For writeAll()
+
+// Wire format of --serve (every integer little-endian), any number of requests per connection:
+//   request:  "I2A1" | mode u32 | widthScale u32 | heightScale u32 | charset length u32 | image length u64 | charset | image
+//   response: "I2A1" | status i32 (ascii::Status) | length u64 | text, ANSI text or PNG bytes
+// Scales of 0 and an empty charset take the server defaults
+#define SERVE_MAGIC            "I2A1"
+#define SERVE_REQUEST_SIZE     28
+#define SERVE_RESPONSE_SIZE    16
+#define SERVE_MAX_CHARSET      256                   // Charset bytes accepted in one request
+#define SERVE_MAX_IMAGE        (256ULL << 20)        // Encoded image bytes accepted in one request unless the server sets its own
+#define SERVE_DEFAULT_HOST     "127.0.0.1"           // TCP addresses given as a bare port stay on localhost
+
+// Request header
+typedef struct {
+    unsigned int mode;
+    unsigned int widthScale;
+    unsigned int heightScale;
+    unsigned int charsetLength;
+    unsigned long long imageLength;
+} ServeRequest;
+
+// Response header
+typedef struct {
+    int status;
+    unsigned long long length;
+} ServeResponse;
+
+static inline void servePut32(unsigned char* p, unsigned int value) {
+    for (int b = 0; b < 4; b++) p[b] = (unsigned char)(value >> (8 * b));
+}
+
+static inline void servePut64(unsigned char* p, unsigned long long value) {
+    for (int b = 0; b < 8; b++) p[b] = (unsigned char)(value >> (8 * b));
+}
+
+static inline unsigned int serveGet32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static inline unsigned long long serveGet64(const unsigned char* p) {
+    return (unsigned long long)serveGet32(p) | ((unsigned long long)serveGet32(p + 4) << 32);
+}
+
+static inline void serveEncodeRequest(const ServeRequest* request, unsigned char header[SERVE_REQUEST_SIZE]) {
+    memcpy(header, SERVE_MAGIC, 4);
+    servePut32(header + 4, request->mode);
+    servePut32(header + 8, request->widthScale);
+    servePut32(header + 12, request->heightScale);
+    servePut32(header + 16, request->charsetLength);
+    servePut64(header + 20, request->imageLength);
+}
+
+// Returns 0 on success and -1 on a bad magic or sizes over the limits (maxImage image bytes)
+static inline int serveDecodeRequest(const unsigned char header[SERVE_REQUEST_SIZE], ServeRequest* request,
+                                     unsigned long long maxImage) {
+    if (memcmp(header, SERVE_MAGIC, 4) != 0) return -1;
+    request->mode = serveGet32(header + 4);
+    request->widthScale = serveGet32(header + 8);
+    request->heightScale = serveGet32(header + 12);
+    request->charsetLength = serveGet32(header + 16);
+    request->imageLength = serveGet64(header + 20);
+    return (request->charsetLength <= SERVE_MAX_CHARSET && request->imageLength <= maxImage) ? 0 : -1;
+}
+
+static inline void serveEncodeResponse(const ServeResponse* response, unsigned char header[SERVE_RESPONSE_SIZE]) {
+    memcpy(header, SERVE_MAGIC, 4);
+    servePut32(header + 4, (unsigned int)response->status);
+    servePut64(header + 8, response->length);
+}
+
+// Returns 0 on success and -1 on a bad magic
+static inline int serveDecodeResponse(const unsigned char header[SERVE_RESPONSE_SIZE], ServeResponse* response) {
+    if (memcmp(header, SERVE_MAGIC, 4) != 0) return -1;
+    response->status = (int)serveGet32(header + 4);
+    response->length = serveGet64(header + 8);
+    return 0;
+}
+
+// Reads exactly size bytes, retrying on short reads and EINTR
+// Returns 0 on success, 1 if the peer closed before the first byte and -1 on error or a truncated read
+static inline int readAll(int fd, void* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = read(fd, (char*)data + done, size - done);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (got == 0) return done == 0 ? 1 : -1;
+        done += (size_t)got;
+    }
+    return 0;
+}
+
+// Splits a TCP address: "PORT" or "HOST:PORT" (digits after the last colon, no slash)
+// Returns 0 for TCP and -1 for anything else (a Unix socket path)
+static inline int serveTcpAddress(const char* address, char* host, size_t hostSize, char* port, size_t portSize) {
+    if (strchr(address, '/') != NULL) return -1;
+    const char* colon = strrchr(address, ':');
+    const char* digits = colon != NULL ? colon + 1 : address;
+    if (*digits == '\0' || strspn(digits, "0123456789") != strlen(digits)) return -1;
+    if (colon != NULL && colon != address) {
+        snprintf(host, hostSize, "%.*s", (int)(colon - address), address);
+    } else {
+        snprintf(host, hostSize, "%s", SERVE_DEFAULT_HOST);
+    }
+    snprintf(port, portSize, "%s", digits);
+    return 0;
+}
+
+// Opens a TCP socket on host:port, listening (server) or connected (client)
+static inline int serveTcpSocket(const char* host, const char* port, bool listening, int backlog) {
+    struct addrinfo hints, *addresses;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (getaddrinfo(host, port, &hints, &addresses) != 0) return -1;
+    int fd = -1;
+    for (struct addrinfo* a = addresses; a != NULL && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));  // Small responses go out at once
+        int status;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            status = (bind(fd, a->ai_addr, a->ai_addrlen) == 0 && listen(fd, backlog) == 0) ? 0 : -1;
+        } else {
+            status = connect(fd, a->ai_addr, a->ai_addrlen);
+        }
+        if (status != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+// Opens a Unix socket at path, listening (server, replacing a stale socket file) or connected (client)
+static inline int serveUnixSocket(const char* path, bool listening, int backlog) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int status;
+    if (listening) {
+        struct stat info;
+        if (stat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+            if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+                close(fd);
+                return -1;  // Another server is still listening there
+            }
+            close(fd);
+            unlink(path);  // Left by a server that did not shut down cleanly
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0) return -1;
+        }
+        status = (bind(fd, (struct sockaddr*)&address, sizeof(address)) == 0 && listen(fd, backlog) == 0) ? 0 : -1;
+    } else {
+        status = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    if (status != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Listening (server) or connected (client) socket of a --serve address: a Unix socket path, "PORT" or "HOST:PORT"
+// Returns the file descriptor or -1 on error
+static inline int serveSocket(const char* address, bool listening, int backlog) {
+    char host[256], port[16];
+    if (serveTcpAddress(address, host, sizeof(host), port, sizeof(port)) == 0) {
+        return serveTcpSocket(host, port, listening, backlog);
+    }
+    return serveUnixSocket(address, listening, backlog);
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef STRIP_ENCODER_H
+#define STRIP_ENCODER_H
+
+#include <atomic>               // For the failure flag shared with the encoder thread
+#include <thread>               // For the encoder thread
+#include <utility>              // For std::pair
+#include <vector>               // For the strip buffers
+#include "pipeline.h"           // For the bounded queues between renderer and encoder
+#include "strip_io.h"           // For the row by row PNG encoder
+#include "thread_pool.h"        // For monotonicSeconds()
+
+#define STRIP_ENCODER_BUFFERS 3  // One strip being rendered, one being compressed, one queued in between
+
+// PNG encoding on its own thread, fed with canvas strips while the caller renders the next ones
+// Strips come from a small ring of buffers, so the whole canvas is never held: acquire() blocks while
+// every buffer waits for the encoder (backpressure) and hands it back once its rows are compressed
+class StripEncoder {
+public:
+    StripEncoder() : free_(STRIP_ENCODER_BUFFERS), filled_(STRIP_ENCODER_BUFFERS), stride_(0), stripRows_(0),
+                     failed_(false), encodeSeconds_(0.0) {
+        memset(&writer_, 0, sizeof(writer_));
+    }
+
+    ~StripEncoder() {
+        if (thread_.joinable()) {
+            abort();
+        }
+    }
+
+    // Creates path (a width x height BGR PNG) and starts the encoder thread
+    // Strips hold up to stripRows pixel rows; returns 0 on success and -1 on error
+    int open(const char* path, int width, int height, int stripRows) {
+        if (stripWriterOpen(&writer_, path, width, height) != 0) {
+            return -1;
+        }
+        stride_ = (size_t)width * 3;
+        stripRows_ = stripRows;
+        buffers_.resize(STRIP_ENCODER_BUFFERS);
+        for (int b = 0; b < STRIP_ENCODER_BUFFERS; b++) {
+            buffers_[b].resize((size_t)stripRows * stride_);
+            free_.push(b);
+        }
+        thread_ = std::thread([this] { encode(); });
+        return 0;
+    }
+
+    size_t stride() const { return stride_; }
+    int stripRows() const { return stripRows_; }
+
+    // Next buffer to render into (stripRows rows, stride() bytes apart), -1 once the encoder has failed
+    int acquire() {
+        int buffer;
+        if (!free_.pop(buffer) || failed_) {
+            return -1;
+        }
+        return buffer;
+    }
+
+    unsigned char* data(int buffer) { return buffers_[buffer].data(); }
+
+    // Queues the first rows of an acquired buffer for compression, in order
+    void submit(int buffer, int rows) {
+        filled_.push(Strip(buffer, rows));
+    }
+
+    // Waits for every queued strip and ends the file; returns 0 on success and -1 on error
+    int finish() {
+        filled_.close();
+        thread_.join();
+        if (failed_) {
+            return -1;
+        }
+        return stripWriterClose(&writer_);
+    }
+
+    // Drops the queued strips and closes the unfinished file
+    void abort() {
+        failed_ = true;
+        filled_.close();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        stripWriterAbort(&writer_);
+    }
+
+    // Time the encoder thread spent compressing (read after finish() or abort())
+    double encodeSeconds() const { return encodeSeconds_; }
+
+private:
+    typedef std::pair<int, int> Strip;  // Buffer, rows
+
+    // Encoder thread: compresses strips in submit order, then hands their buffers back
+    // After a failure strips are still taken (and dropped), so the renderer never waits forever
+    void encode() {
+        Strip strip;
+        while (filled_.pop(strip)) {
+            if (!failed_) {
+                double start = monotonicSeconds();
+                if (stripWriterRows(&writer_, buffers_[strip.first].data(), stride_, strip.second) != 0) {
+                    failed_ = true;
+                }
+                encodeSeconds_ += monotonicSeconds() - start;
+            }
+            free_.push(strip.first);
+        }
+        free_.close();  // Wakes a renderer blocked in acquire() after a failure
+    }
+
+    StripWriter writer_;
+    std::vector<std::vector<unsigned char>> buffers_;
+    BoundedQueue<int> free_;
+    BoundedQueue<Strip> filled_;
+    std::thread thread_;
+    size_t stride_;
+    int stripRows_;
+    std::atomic<bool> failed_;
+    double encodeSeconds_;
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef STRIP_IO_H
+#define STRIP_IO_H
+
+#include <stdio.h>              // For the image files
+#include <stdlib.h>             // For basic functions
+#include <string.h>             // For string manipulation
+#include <setjmp.h>             // For the libpng / libjpeg error exits
+#include <unistd.h>             // For dup() of stdout
+#include <png.h>                // For row by row PNG decoding and encoding
+#include <jpeglib.h>            // For scanline JPEG decoding
+
+// * Strip reader formats
+#define STRIP_FORMAT_PNG  1
+#define STRIP_FORMAT_JPEG 2
+
+#define STRIP_PNG_COMPRESSION 1  // zlib level, the same speed-first default as cv::imwrite
+
+// libjpeg reports fatal errors through error_exit, which must not return
+typedef struct {
+    struct jpeg_error_mgr manager;
+    jmp_buf exit;
+} StripJpegError;
+
+static inline void stripJpegErrorExit(j_common_ptr cinfo) {
+    longjmp(((StripJpegError*)cinfo->err)->exit, 1);
+}
+
+// Decodes an image top to bottom a few rows at a time, without ever holding the whole image
+// Rows come out as BGR (3 channels) or gray (1 channel); JPEGs can be decoded reduced by 2, 4 or 8
+typedef struct {
+    int format;
+    int width;              // Decoded size (reduced for JPEG)
+    int height;
+    int sourceWidth;        // Size stored in the file
+    int sourceHeight;
+    int channels;
+    int nextRow;
+    FILE* file;
+    png_structp png;
+    png_infop pngInfo;
+    struct jpeg_decompress_struct* jpeg;
+    StripJpegError* jpegError;
+} StripReader;
+
+// Releases every decoder resource (safe on a partly opened reader)
+static inline void stripReaderClose(StripReader* reader) {
+    if (reader->png != NULL) {
+        png_destroy_read_struct(&reader->png, &reader->pngInfo, NULL);
+    }
+    if (reader->jpeg != NULL) {
+        jpeg_destroy_decompress(reader->jpeg);
+        free(reader->jpeg);
+    }
+    free(reader->jpegError);
+    if (reader->file != NULL) {
+        fclose(reader->file);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+// PNG: every bit depth and color type is expanded to 8-bit BGR (or gray), alpha is dropped
+// Interlaced PNGs need every pass before the first row is final, so they are not streamed
+static inline int stripReaderOpenPNG(StripReader* reader, bool gray) {
+    reader->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (reader->png == NULL) return -1;
+    reader->pngInfo = png_create_info_struct(reader->png);
+    if (reader->pngInfo == NULL) return -1;
+    if (setjmp(png_jmpbuf(reader->png))) return -1;
+
+    png_init_io(reader->png, reader->file);
+    png_read_info(reader->png, reader->pngInfo);
+    if (png_get_interlace_type(reader->png, reader->pngInfo) != PNG_INTERLACE_NONE) return -1;
+
+    int colorType = png_get_color_type(reader->png, reader->pngInfo);
+    png_set_expand(reader->png);       // Palette, low bit gray and tRNS to 8-bit channels
+    png_set_strip_16(reader->png);
+    png_set_strip_alpha(reader->png);
+    if (gray && (colorType & PNG_COLOR_MASK_COLOR)) {
+        png_set_rgb_to_gray_fixed(reader->png, 1, 29900, 58700);  // BT.601, like the in-memory luma
+    } else if (!gray && !(colorType & PNG_COLOR_MASK_COLOR)) {
+        png_set_gray_to_rgb(reader->png);
+    }
+    if (!gray) {
+        png_set_bgr(reader->png);
+    }
+    png_read_update_info(reader->png, reader->pngInfo);
+
+    reader->width = reader->sourceWidth = (int)png_get_image_width(reader->png, reader->pngInfo);
+    reader->height = reader->sourceHeight = (int)png_get_image_height(reader->png, reader->pngInfo);
+    reader->channels = gray ? 1 : 3;
+    if (png_get_rowbytes(reader->png, reader->pngInfo) != (size_t)reader->width * reader->channels) return -1;
+    return 0;
+}
+
+// JPEG: libjpeg scales the IDCT down by reduction and converts straight to BGR or gray
+static inline int stripReaderOpenJPEG(StripReader* reader, bool gray, int reduction) {
+    reader->jpeg = (struct jpeg_decompress_struct*)calloc(1, sizeof(struct jpeg_decompress_struct));
+    reader->jpegError = (StripJpegError*)calloc(1, sizeof(StripJpegError));
+    if (reader->jpeg == NULL || reader->jpegError == NULL) return -1;
+    reader->jpeg->err = jpeg_std_error(&reader->jpegError->manager);
+    reader->jpegError->manager.error_exit = stripJpegErrorExit;
+    if (setjmp(reader->jpegError->exit)) return -1;
+
+    jpeg_create_decompress(reader->jpeg);
+    jpeg_stdio_src(reader->jpeg, reader->file);
+    jpeg_read_header(reader->jpeg, TRUE);
+    reader->jpeg->scale_num = 1;
+    reader->jpeg->scale_denom = (unsigned int)reduction;
+    reader->jpeg->out_color_space = gray ? JCS_GRAYSCALE : JCS_EXT_BGR;
+    jpeg_start_decompress(reader->jpeg);
+
+    reader->width = (int)reader->jpeg->output_width;
+    reader->height = (int)reader->jpeg->output_height;
+    reader->sourceWidth = (int)reader->jpeg->image_width;
+    reader->sourceHeight = (int)reader->jpeg->image_height;
+    reader->channels = gray ? 1 : 3;
+    return reader->jpeg->output_components == reader->channels ? 0 : -1;
+}
+
+// Opens a PNG or JPEG for strip decoding
+// Returns 0 on success and -1 for other formats, interlaced PNGs or damaged headers
+static inline int stripReaderOpen(StripReader* reader, const char* path, bool gray, int reduction) {
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) return -1;
+
+    unsigned char signature[8];
+    size_t size = fread(signature, 1, sizeof(signature), reader->file);
+    rewind(reader->file);
+    int status = -1;
+    if (size == sizeof(signature) && png_sig_cmp(signature, 0, sizeof(signature)) == 0) {
+        reader->format = STRIP_FORMAT_PNG;
+        status = stripReaderOpenPNG(reader, gray);
+    } else if (size >= 2 && signature[0] == 0xFF && signature[1] == 0xD8) {
+        reader->format = STRIP_FORMAT_JPEG;
+        status = stripReaderOpenJPEG(reader, gray, reduction);
+    }
+    if (status != 0) {
+        stripReaderClose(reader);
+    }
+    return status;
+}
+
+// Decodes the next count rows into dst (rows stride bytes apart)
+// Returns 0 on success and -1 on a decode error or past the last row
+static inline int stripReaderRead(StripReader* reader, unsigned char* dst, size_t stride, int count) {
+    if (count < 0 || reader->nextRow + count > reader->height) return -1;
+    if (reader->format == STRIP_FORMAT_PNG) {
+        if (setjmp(png_jmpbuf(reader->png))) return -1;
+        for (int i = 0; i < count; i++) {
+            png_read_row(reader->png, dst + (size_t)i * stride, NULL);
+        }
+    } else {
+        if (setjmp(reader->jpegError->exit)) return -1;
+        for (int i = 0; i < count; i++) {
+            JSAMPROW row = dst + (size_t)i * stride;
+            if (jpeg_read_scanlines(reader->jpeg, &row, 1) != 1) return -1;
+        }
+    }
+    reader->nextRow += count;
+    return 0;
+}
+
+// Encodes a BGR image into a PNG file a few rows at a time, the whole image is never held
+typedef struct {
+    FILE* file;
+    png_structp png;
+    png_infop info;
+} StripWriter;
+
+// Releases the encoder, closes the file and returns -1 if anything failed
+static inline int stripWriterAbort(StripWriter* writer) {
+    if (writer->png != NULL) {
+        png_destroy_write_struct(&writer->png, &writer->info);
+    }
+    if (writer->file != NULL) {
+        fclose(writer->file);
+    }
+    memset(writer, 0, sizeof(*writer));
+    return -1;
+}
+
+// Writes the header of a width x height 8-bit BGR PNG to file (e.g. open_memstream()), which the writer then owns
+// Returns 0 on success and -1 on error (file is closed)
+static inline int stripWriterOpenFile(StripWriter* writer, FILE* file, int width, int height) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = file;
+    if (writer->file == NULL) return -1;
+    writer->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (writer->png == NULL) return stripWriterAbort(writer);
+    writer->info = png_create_info_struct(writer->png);
+    if (writer->info == NULL) return stripWriterAbort(writer);
+    if (setjmp(png_jmpbuf(writer->png))) return stripWriterAbort(writer);
+
+    png_init_io(writer->png, writer->file);
+    png_set_IHDR(writer->png, writer->info, (png_uint_32)width, (png_uint_32)height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_compression_level(writer->png, STRIP_PNG_COMPRESSION);
+    png_write_info(writer->png, writer->info);
+    png_set_bgr(writer->png);
+    return 0;
+}
+
+// Creates path ("-" for stdout) and writes the header of a width x height 8-bit BGR PNG
+// Returns 0 on success and -1 on error
+static inline int stripWriterOpen(StripWriter* writer, const char* path, int width, int height) {
+    FILE* file;
+    if (strcmp(path, "-") == 0) {
+        int fd = dup(STDOUT_FILENO);  // Closed with the stream, stdout itself stays open
+        file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if (file == NULL && fd >= 0) close(fd);
+    } else {
+        file = fopen(path, "wb");
+    }
+    return stripWriterOpenFile(writer, file, width, height);
+}
+
+// Encodes the next count rows of src (rows stride bytes apart)
+// Returns 0 on success and -1 on error (the writer is released)
+static inline int stripWriterRows(StripWriter* writer, const unsigned char* src, size_t stride, int count) {
+    if (setjmp(png_jmpbuf(writer->png))) return stripWriterAbort(writer);
+    for (int i = 0; i < count; i++) {
+        png_write_row(writer->png, (png_const_bytep)(src + (size_t)i * stride));
+    }
+    return 0;
+}
+
+// Writes the end of the PNG and closes the file
+// Returns 0 on success and -1 on error
+static inline int stripWriterClose(StripWriter* writer) {
+    if (setjmp(png_jmpbuf(writer->png))) return stripWriterAbort(writer);
+    png_write_end(writer->png, writer->info);
+    png_destroy_write_struct(&writer->png, &writer->info);
+    int status = fclose(writer->file) == 0 ? 0 : -1;
+    memset(writer, 0, sizeof(*writer));
+    return status;
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <chrono>               // For the per-worker busy time
+#include <condition_variable>   // For waking pool threads and waiting for them
+#include <functional>           // For the band callback
+#include <memory>               // For the per-worker queues
+#include <mutex>                // For the queue locks
+#include <thread>               // For the worker threads
+#include <vector>               // For the worker list
+
+// Number of threads used when --threads is not given (every core)
+static inline int defaultThreadCount(void) {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Monotonic clock in seconds, for stage and worker timings
+static inline double monotonicSeconds(void) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Thread of the shared pool, it sleeps until it is handed a task
+struct PoolThread {
+    std::mutex lock;
+    std::condition_variable wake;
+    std::function<void()> task;  // Empty while idle
+};
+
+// Threads kept alive across calls, so parallel stages do not spawn and join threads on every image or frame
+// A thread runs one task at a time and only idle threads are handed one, so tasks that wait for each other
+// (the Floyd-Steinberg wavefront) always run at once and callers on different threads never block each other
+struct ThreadPool {
+    std::mutex lock;
+    std::vector<PoolThread*> idle;
+};
+
+// The pool of the process (inline, not static, so every translation unit shares it)
+// It is never destroyed: idle threads are detached and simply sleep through exit
+inline ThreadPool& sharedThreadPool(void) {
+    static ThreadPool* pool = new ThreadPool();
+    return *pool;
+}
+
+// Body of a pool thread: runs the tasks it is handed, going back to the idle list after each one
+static inline void poolThreadLoop(ThreadPool* pool, PoolThread* self) {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(self->lock);
+            self->wake.wait(guard, [self] { return (bool)self->task; });
+            task.swap(self->task);
+        }
+        task();
+        task = nullptr;
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->idle.push_back(self);
+    }
+}
+
+// Hands task to an idle pool thread, starting a new one when none is idle (the pool grows to the peak demand)
+static inline void poolRun(std::function<void()> task) {
+    ThreadPool& pool = sharedThreadPool();
+    PoolThread* thread = NULL;
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        if (!pool.idle.empty()) {
+            thread = pool.idle.back();
+            pool.idle.pop_back();
+        }
+    }
+    if (thread == NULL) {
+        thread = new PoolThread();
+        std::thread(poolThreadLoop, &pool, thread).detach();
+    }
+    std::lock_guard<std::mutex> guard(thread->lock);
+    thread->task.swap(task);
+    thread->wake.notify_one();
+}
+
+// Runs work(t) for every t in [0, threads) at the same time, t = 0 on the caller and the others on pool threads
+// Returns once all of them are done
+static inline void runOnThreads(int threads, const std::function<void(int)>& work) {
+    if (threads <= 1) {
+        work(0);
+        return;
+    }
+    std::mutex lock;
+    std::condition_variable done;
+    int pending = threads - 1;
+    for (int t = 1; t < threads; t++) {
+        poolRun([&, t] {
+            work(t);
+            std::lock_guard<std::mutex> guard(lock);  // Notified under the lock, so the caller cannot return first
+            if (--pending == 0) done.notify_one();
+        });
+    }
+    work(0);
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&] { return pending == 0; });
+}
+
+// Work done by one worker of parallelForBands (only measured when asked for)
+struct WorkerLoad {
+    int bands;
+    double busySeconds;
+};
+
+// Splits rows in bands of consecutive rows, a few per thread so stealing can balance uneven work
+// Returns the number of rows per band
+static inline int bandRowsFor(int rows, int threads) {
+    int bands = threads * 4;
+    int bandRows = (rows + bands - 1) / (bands > 0 ? bands : 1);
+    return bandRows > 0 ? bandRows : 1;
+}
+
+// Range of band indexes owned by one worker
+// The owner pops from the front and thieves take the back half, both under the lock
+struct BandQueue {
+    std::mutex lock;
+    int next;
+    int end;
+};
+
+// Takes the next band of a queue, returns -1 if it is empty
+static inline int popBand(BandQueue& queue) {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    return (queue.next < queue.end) ? queue.next++ : -1;
+}
+
+// Moves the back half of the fullest other queue into the thief queue
+// Returns 0 if there was nothing left to steal
+static inline int stealBands(std::vector<std::unique_ptr<BandQueue>>& queues, int thief) {
+    for (;;) {
+        int victim = -1;
+        int most = 0;
+        for (int q = 0; q < (int)queues.size(); q++) {
+            if (q == thief) continue;
+            std::lock_guard<std::mutex> guard(queues[q]->lock);
+            if (queues[q]->end - queues[q]->next > most) {
+                most = queues[q]->end - queues[q]->next;
+                victim = q;
+            }
+        }
+        if (victim < 0) return 0;
+
+        int begin, end;
+        {
+            std::lock_guard<std::mutex> guard(queues[victim]->lock);
+            int left = queues[victim]->end - queues[victim]->next;
+            if (left <= 0) continue;  // Emptied meanwhile, look again
+            begin = queues[victim]->end - (left + 1) / 2;
+            end = queues[victim]->end;
+            queues[victim]->end = begin;
+        }
+        std::lock_guard<std::mutex> guard(queues[thief]->lock);
+        queues[thief]->next = begin;
+        queues[thief]->end = end;
+        return 1;
+    }
+}
+
+// Runs work(band) for every band in [0, bands) on up to threads threads (the caller is one of them)
+// Bands start evenly split in contiguous ranges and idle workers steal from the busiest one
+// Every band runs exactly once, so results written at fixed offsets do not depend on the thread count
+// With loads, worker t adds its band count and busy time to (*loads)[t] (no clock reads without it)
+static inline void parallelForBands(int bands, int threads, const std::function<void(int)>& work,
+                                    std::vector<WorkerLoad>* loads = NULL) {
+    if (threads > bands) threads = bands;
+    if (loads != NULL && (int)loads->size() < (threads > 1 ? threads : 1)) {
+        loads->resize(threads > 1 ? threads : 1);  // New entries start at zero
+    }
+    auto run = [&](int t, int band) {
+        if (loads == NULL) {
+            work(band);
+            return;
+        }
+        double start = monotonicSeconds();
+        work(band);
+        (*loads)[t].bands++;
+        (*loads)[t].busySeconds += monotonicSeconds() - start;
+    };
+    if (threads <= 1) {
+        for (int band = 0; band < bands; band++) run(0, band);
+        return;
+    }
+
+    std::vector<std::unique_ptr<BandQueue>> queues;
+    for (int t = 0; t < threads; t++) {
+        queues.emplace_back(new BandQueue());
+        queues[t]->next = (int)((long long)bands * t / threads);
+        queues[t]->end = (int)((long long)bands * (t + 1) / threads);
+    }
+
+    auto worker = [&](int t) {
+        for (;;) {
+            int band = popBand(*queues[t]);
+            if (band < 0) {
+                if (!stealBands(queues, t)) return;
+                continue;
+            }
+            run(t, band);
+        }
+    };
+
+    runOnThreads(threads, worker);
+}
+
+#endif
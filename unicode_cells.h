@@ -0,0 +1,218 @@
+#ifndef UNICODE_CELLS_H
+#define UNICODE_CELLS_H
+
+#include <opencv2/opencv.hpp>   // For image manipulation
+#include <stdio.h>              // Default lib for input/output
+#include <string.h>             // For string manipulation
+#include <vector>               // For the subcell bounds and band buffers
+#include "ansi_color.h"         // For the color escapes of half blocks
+#include "cell_average.h"       // For the cell and subcell averages and the band scheduler
+
+// SSE2 is part of every x86-64 CPU, so the Braille mask kernel needs no run-time dispatch
+#if defined(__SSE2__)
+#include <emmintrin.h>          // For SSE2 intrinsics
+#define UNICODE_CELLS_SSE2 1
+#endif
+
+// * Half blocks: U+2580 (upper half block), the foreground paints the top half of the cell, the background the bottom
+#define HALF_BLOCK_GLYPH          "\xE2\x96\x80"
+#define HALF_BLOCK_GLYPH_BYTES    3
+#define HALF_BLOCK_MAX_CELL_BYTES (2 * (ANSI_ESCAPE_MAX - 1) + HALF_BLOCK_GLYPH_BYTES)  // Both escapes plus the glyph
+
+// * Braille: U+2800 - U+28FF, one dot per 2x4 subcell, bit b of the mask lights dot b + 1
+#define BRAILLE_DOTS_X     2
+#define BRAILLE_DOTS_Y     4
+#define BRAILLE_CELL_BYTES 3        // Every pattern is 3 bytes of UTF-8
+#define BRAILLE_TABLE_SIZE (256 * BRAILLE_CELL_BYTES)
+#define BRAILLE_THRESHOLD  128      // Subcells at least this bright light their dot
+
+// Dot bits of subcell row r, left and right column (the last row was added to the 6-dot cell as dots 7 and 8)
+static const unsigned char brailleDotBits[BRAILLE_DOTS_Y][BRAILLE_DOTS_X] = {{0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+// Builds the dot mask -> UTF-8 table once per converter (E2 A0 80 + mask, 6 bits in the last byte)
+static inline void buildBrailleTable(unsigned char table[BRAILLE_TABLE_SIZE]) {
+    for (int mask = 0; mask < 256; mask++) {
+        table[BRAILLE_CELL_BYTES * mask] = 0xE2;
+        table[BRAILLE_CELL_BYTES * mask + 1] = (unsigned char)(0xA0 | (mask >> 6));
+        table[BRAILLE_CELL_BYTES * mask + 2] = (unsigned char)(0x80 | (mask & 0x3F));
+    }
+}
+
+// Dot masks of n cells from the four subcell rows of a text row (dots[r] holds 2 * n intensities, left dot first)
+// Reference version (one dot at a time), the SSE2 kernel below must always match it
+static inline void brailleMasksScalar(const unsigned char* const dots[BRAILLE_DOTS_Y], int n, unsigned char* masks) {
+    for (int j = 0; j < n; j++) {
+        unsigned char mask = 0;
+        for (int r = 0; r < BRAILLE_DOTS_Y; r++) {
+            for (int c = 0; c < BRAILLE_DOTS_X; c++) {
+                if (dots[r][BRAILLE_DOTS_X * j + c] >= BRAILLE_THRESHOLD) mask |= brailleDotBits[r][c];
+            }
+        }
+        masks[j] = mask;
+    }
+}
+
+#ifdef UNICODE_CELLS_SSE2
+// SSE2 kernel: 8 cells per step, one compare per subcell row gives 0xFF for every lit dot, AND keeps its bit
+// and the left and right bytes of every cell are folded with a 16-bit shift, then packed to one byte per cell
+static inline void brailleMasksSSE2(const unsigned char* const dots[BRAILLE_DOTS_Y], int n, unsigned char* masks) {
+    const __m128i bias = _mm_set1_epi8((char)0x80);  // Unsigned bytes compared as signed ones
+    const __m128i threshold = _mm_set1_epi8((char)((BRAILLE_THRESHOLD - 1) ^ 0x80));
+    const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+    __m128i bits[BRAILLE_DOTS_Y];
+    for (int r = 0; r < BRAILLE_DOTS_Y; r++) {
+        bits[r] = _mm_set1_epi16((short)(brailleDotBits[r][0] | (brailleDotBits[r][1] << 8)));
+    }
+
+    int j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m128i mask = _mm_setzero_si128();
+        for (int r = 0; r < BRAILLE_DOTS_Y; r++) {
+            __m128i values = _mm_loadu_si128((const __m128i*)(dots[r] + BRAILLE_DOTS_X * j));
+            __m128i lit = _mm_cmpgt_epi8(_mm_xor_si128(values, bias), threshold);
+            mask = _mm_or_si128(mask, _mm_and_si128(lit, bits[r]));
+        }
+        mask = _mm_and_si128(_mm_or_si128(mask, _mm_srli_epi16(mask, 8)), lowBytes);
+        _mm_storel_epi64((__m128i*)(masks + j), _mm_packus_epi16(mask, mask));
+    }
+    if (j < n) {
+        const unsigned char* rest[BRAILLE_DOTS_Y];
+        for (int r = 0; r < BRAILLE_DOTS_Y; r++) rest[r] = dots[r] + BRAILLE_DOTS_X * j;
+        brailleMasksScalar(rest, n - j, masks + j);
+    }
+}
+#endif
+
+// Dot masks of a row of cells
+static inline void brailleMasks(const unsigned char* const dots[BRAILLE_DOTS_Y], int n, unsigned char* masks) {
+#ifdef UNICODE_CELLS_SSE2
+    brailleMasksSSE2(dots, n, masks);
+#else
+    brailleMasksScalar(dots, n, masks);
+#endif
+}
+
+// Checks the Braille mask kernel against the scalar one on every intensity around the threshold
+// Returns the number of mismatches
+static inline int brailleSelfTest(void) {
+    int failures = 0;
+#ifdef UNICODE_CELLS_SSE2
+    const int n = 67;  // Full steps and a scalar tail
+    std::vector<unsigned char> rows[BRAILLE_DOTS_Y];
+    const unsigned char* dots[BRAILLE_DOTS_Y];
+    unsigned int seed = 4321;
+    for (int r = 0; r < BRAILLE_DOTS_Y; r++) {
+        rows[r].resize(BRAILLE_DOTS_X * n);
+        for (size_t k = 0; k < rows[r].size(); k++) {
+            seed = seed * 1103515245u + 12345u;
+            rows[r][k] = (unsigned char)(k % 3 == 0 ? (seed >> 16) : BRAILLE_THRESHOLD - 2 + (int)((seed >> 16) % 4));
+        }
+        dots[r] = rows[r].data();
+    }
+    std::vector<unsigned char> expected(n), masks(n);
+    brailleMasksScalar(dots, n, expected.data());
+    brailleMasksSSE2(dots, n, masks.data());
+    if (masks != expected) {
+        printf("Mismatch: Braille mask kernel sse2\n");
+        failures++;
+    }
+#endif
+    return failures;
+}
+
+// Braille text conversion: 2x4 subcell luma of every cell, thresholded to its dot pattern and written through the
+// UTF-8 table straight into frame (rows * (cols * BRAILLE_CELL_BYTES + 1) bytes, breaklines included)
+static inline void brailleToText(const cv::Mat& src, const std::vector<int>& xBounds, const std::vector<int>& yBounds, bool swapRB,
+                                 const unsigned char* brailleTable, char* frame, int threads, std::vector<WorkerLoad>* loads = NULL) {
+    int rows = (int)yBounds.size() - 1;
+    int cols = (int)xBounds.size() - 1;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    std::vector<int> xSub, ySub;
+    subcellBounds(xBounds, BRAILLE_DOTS_X, xSub);
+    subcellBounds(yBounds, BRAILLE_DOTS_Y, ySub);
+    size_t rowBytes = (size_t)cols * BRAILLE_CELL_BYTES + 1;
+
+    parallelForBands(bands, threads, [&](int band) {
+        int n = cols * BRAILLE_DOTS_X;
+        std::vector<unsigned long long> sums(subcellScratchSize(src));
+        std::vector<unsigned char> subrows((size_t)BRAILLE_DOTS_Y * n), masks(cols);
+        const unsigned char* dots[BRAILLE_DOTS_Y];
+        int last = (band + 1) * bandRows < rows ? (band + 1) * bandRows : rows;
+        for (int i = band * bandRows; i < last; i++) {
+            for (int r = 0; r < BRAILLE_DOTS_Y; r++) {
+                int sub = i * BRAILLE_DOTS_Y + r;
+                averageSubcellRow(src, xSub.data(), n, ySub[2 * sub], ySub[2 * sub + 1], swapRB, sums.data(), &subrows[(size_t)r * n]);
+                dots[r] = &subrows[(size_t)r * n];
+            }
+            brailleMasks(dots, cols, masks.data());
+            char* row = frame + (size_t)i * rowBytes;
+            for (int j = 0; j < cols; j++) {
+                memcpy(row + (size_t)j * BRAILLE_CELL_BYTES, brailleTable + BRAILLE_CELL_BYTES * masks[j], BRAILLE_CELL_BYTES);
+            }
+            row[rowBytes - 1] = '\n';  // Breakline at the end of each row
+        }
+    }, loads);
+}
+
+// Converts one row of half blocks: an escape only when the foreground or background changes from the previous cell
+// Cells with equal halves are a space on the background, so solid areas cost one byte per cell
+// Every row ends with a reset and a breakline; dst needs cols * HALF_BLOCK_MAX_CELL_BYTES + 5 bytes, returns the bytes written
+static inline size_t halfBlockRowToText(const uchar* top, const uchar* bottom, int cols, char* dst) {
+    size_t n = 0;
+    int previousTop = -1, previousBottom = -1;
+    for (int j = 0; j < cols; j++) {
+        cv::Vec3b upper(top[3 * j], top[3 * j + 1], top[3 * j + 2]);
+        cv::Vec3b lower(bottom[3 * j], bottom[3 * j + 1], bottom[3 * j + 2]);
+        int topKey = (upper[2] << 16) | (upper[1] << 8) | upper[0];
+        int bottomKey = (lower[2] << 16) | (lower[1] << 8) | lower[0];
+        if (bottomKey != previousBottom) {
+            n += rgbToAnsiBackground(lower, dst + n);
+            previousBottom = bottomKey;
+        }
+        if (topKey == bottomKey) {
+            dst[n++] = ' ';
+            continue;
+        }
+        if (topKey != previousTop) {
+            n += rgbToAnsiColor(upper, dst + n);
+            previousTop = topKey;
+        }
+        memcpy(dst + n, HALF_BLOCK_GLYPH, HALF_BLOCK_GLYPH_BYTES);
+        n += HALF_BLOCK_GLYPH_BYTES;
+    }
+    memcpy(dst + n, ANSI_RESET "\n", 5);
+    return n + 5;
+}
+
+// Half-block text conversion: the top and bottom halves of every cell are box-averaged to BGR and written as
+// colored U+2580, one buffer per band (stitched in order by the caller, like convertAnsiFrame())
+static inline void halfBlockToText(const cv::Mat& src, const std::vector<int>& xBounds, const std::vector<int>& yBounds, bool swapRB,
+                                   int threads, std::vector<std::vector<char>>& bandText, std::vector<WorkerLoad>* loads = NULL) {
+    int rows = (int)yBounds.size() - 1;
+    int cols = (int)xBounds.size() - 1;
+    int bandRows = bandRowsFor(rows, threads);
+    int bands = (rows + bandRows - 1) / bandRows;
+    std::vector<int> ySub;
+    subcellBounds(yBounds, 2, ySub);
+    bandText.assign(bands, std::vector<char>());
+
+    parallelForBands(bands, threads, [&](int band) {
+        std::vector<unsigned long long> sums((size_t)cols * 3);
+        std::vector<uchar> top((size_t)cols * 3), bottom((size_t)cols * 3);
+        int first = band * bandRows;
+        int last = first + bandRows < rows ? first + bandRows : rows;
+        std::vector<char>& text = bandText[band];
+        text.resize((size_t)(last - first) * ((size_t)cols * HALF_BLOCK_MAX_CELL_BYTES + 5));
+        size_t used = 0;
+        for (int i = first; i < last; i++) {
+            // Subcell bounds are (start, end) pairs, so each half reads as a one-row cell grid
+            averageCellRow(src, xBounds.data(), &ySub[4 * i], 0, cols, swapRB, sums.data(), top.data(), NULL);
+            averageCellRow(src, xBounds.data(), &ySub[4 * i + 2], 0, cols, swapRB, sums.data(), bottom.data(), NULL);
+            used += halfBlockRowToText(top.data(), bottom.data(), cols, text.data() + used);
+        }
+        text.resize(used);
+    }, loads);
+}
+
+#endif